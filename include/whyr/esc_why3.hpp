@@ -16,6 +16,7 @@
 
 #include <unordered_map>
 #include <unordered_set>
+#include <mutex>
 
 namespace whyr {
     using namespace std;
@@ -35,7 +36,7 @@ namespace whyr {
      */
     struct TypeInfo {
         /// The module we're type checking.
-        AnnotatedModule* module;
+        AnnotatedModule* module = NULL;
         /// All the integer types used.
         unordered_set<IntegerType*> intTypes;
         /// All the pointer types used.
@@ -66,13 +67,92 @@ namespace whyr {
     void getTypeInfo(TypeInfo &info, Type* type);
     /// Retrieves type information. See struct TypeInfo for details.
     void getTypeInfo(TypeInfo &info, AnnotatedFunction* func, Instruction* inst);
-    /// Retrieves type information. See struct TypeInfo for details.
+    /// Retrieves type information. See struct TypeInfo for details. This uses the function's cached type information.
     void getTypeInfo(TypeInfo &info, AnnotatedFunction* func);
-    /// Retrieves type information. See struct TypeInfo for details.
+    /// Retrieves type information. See struct TypeInfo for details. This uses the module's cached type information.
     void getTypeInfo(TypeInfo &info, AnnotatedModule* module);
+    /// Retrieves type information by walking the whole function. Use AnnotatedFunction::getTypeInfo to get a cached version of this.
+    void computeTypeInfo(TypeInfo &info, AnnotatedFunction* func);
+    /// Retrieves type information of all functions and globals. Use AnnotatedModule::getTypeInfo to get a cached version of this.
+    void computeTypeInfo(TypeInfo &info, AnnotatedModule* module);
     /// This copies all data from 'other' into 'info', appending to lists as needed.
     void getTypeInfo(TypeInfo &info, TypeInfo &other);
     
+    /*
+     * 
+     * GOAL DISCOVERY
+     * 
+     */
+    
+    /**
+     * This represents a single goal of a function: a clause to prove, and the instruction it must hold at.
+     */
+    struct GoalSite {
+        /// The name of the theory (and goal) generated for this site.
+        string theoryName;
+        /// The clause to prove. This is an ensures, assert, or callee requires clause.
+        LogicExpression* goalExpr;
+        /// The instruction the clause must hold at. NULL for ensures clauses.
+        Instruction* goalInst;
+        /// The number identifying this goal in the function's goal base theory. Starts at 1.
+        unsigned id;
+    };
+    
+    /**
+     * This represents all the goals of a single function.
+     * Call getFunctionGoals to fill it.
+     */
+    struct FunctionGoals {
+        /// The goals of the function, in the order they should be emitted.
+        list<GoalSite> sites;
+        /// Maps a goal's instruction and clause to its ID.
+        map<pair<Instruction*, LogicExpression*>, unsigned> ids;
+        
+        /// Returns the ID of the goal with the given clause at the given instruction, or 0 if it is not a goal.
+        unsigned getID(LogicExpression* goalExpr, Instruction* goalInst);
+    };
+    
+    /**
+     * Finds all the goals of a function.
+     * 'asserts' and 'calls' are the module-wide counters used to make goal names unique. They are incremented as goals are found.
+     */
+    void getFunctionGoals(FunctionGoals &goals, AnnotatedFunction* func, unsigned &asserts, unsigned &calls);
+    
+    /*
+     * 
+     * FUNCTION LAYOUT
+     * 
+     */
+    
+    /**
+     * This represents the position and Why3 names of a single instruction. See class FunctionLayout for details.
+     */
+    struct InstructionLayout {
+        /// The name of the predicate representing the effects of the instruction.
+        string statementName;
+        /// The name of the statepoint constant in effect before the instruction executes.
+        string statepointBefore;
+    };
+    
+    /**
+     * Statement and statepoint names depend on an instruction's position in its block, and on every store, alloca and call before it.
+     * This records them for every instruction of a function in one pass, so Why3 generation can look them up instead of rescanning the block.
+     * 
+     * Do not construct this directly; call AnnotatedFunction::getLayout instead.
+     */
+    class FunctionLayout {
+    protected:
+        unordered_map<Instruction*, InstructionLayout> insts;
+    public:
+        FunctionLayout(AnnotatedFunction* func);
+        
+        /**
+         * Returns the layout of an instruction in the function.
+         * Throws a whyr_exception if the instruction is not part of the function.
+         */
+        InstructionLayout& getInstruction(Instruction* inst);
+    };
+    
     /*
      * 
      * NAME MANGLING
@@ -86,12 +166,46 @@ namespace whyr {
      *    2. You run the user-supplied portion of the name through this function.
      */
     string getWhy3SafeName(string name);
+    /**
+     * This hands out the temporary names of one module's nameless values. Named values are mangled directly, and need no state.
+     * 
+     * Goal generation calls seal once every temporary name it needs has been given out, before it starts any threads.
+     * From then on, temporary names are looked up without locking, and asking for a new one is an internal error,
+     * since the number it got would depend on the order the threads happened to ask in.
+     * 
+     * Do not construct this directly; call AnnotatedModule::getNameMangler instead.
+     */
+    class NameMangler {
+    protected:
+        mutex lock;
+        bool sealed = false;
+        unordered_map<const void*, unsigned> tempNames;
+        unsigned tempNameCounter = 0;
+    public:
+        /**
+         * See the global getTempName function.
+         */
+        string getTempName(const void* p);
+        /**
+         * Stops tempNames from changing. Call this from one thread, before any other thread uses the mangler.
+         * After this, getTempName throws for any pointer not already named.
+         */
+        void seal();
+        /**
+         * See getWhy3VarName.
+         */
+        string getVarName(Value* var);
+        /**
+         * See getWhy3BlockName.
+         */
+        string getBlockName(BasicBlock* block);
+    };
     /**
      * Sometimes, we need an identifier number for a unique, yet nameless entity.
      * getTempName provides such functionality, by mapping pointers to an incrementing counter.
-     * It is garunteed to produce the same ID string for the same pointer.
+     * It is garunteed to produce the same ID string for the same pointer in the same module.
      */
-    string getTempName(void* p);
+    string getTempName(AnnotatedModule* module, void* p);
     /**
      * Returns the theory name of a LLVM type.
      * For example, LLVM's "i32*" type is inside the "I32P" theory.
@@ -117,16 +231,21 @@ namespace whyr {
      * Be sure to "use import" any theories you reference!
      */
     string getWhy3TheoryName(AnnotatedFunction* func);
+    /**
+     * Returns the name of the theory containing the blocks of a function shared by all its goals.
+     * See addGoalBase for details.
+     */
+    string getWhy3GoalBaseTheoryName(AnnotatedFunction* func);
     /**
      * Returns the name of a constant representing a local variable.
      */
-    string getWhy3VarName(Value* var);
+    string getWhy3VarName(AnnotatedModule* module, Value* var);
     /**
      * When a function is called in the model, the argument names are mangled.
      * Use this function to retrieve the constant corresponding to an argument of the function you are calling.
      * 'callee' is the callee theory name, which is the value of Why3Data.calleeTheoryName.
      */
-    string getWhy3ArgName(string callee, Value* var);
+    string getWhy3ArgName(AnnotatedModule* module, string callee, Value* var);
     /**
      * Returns the name of a block expression corresponding to the execution of the specified basic block.
      */
@@ -169,6 +288,12 @@ namespace whyr {
      * 
      */
     
+    /**
+     * Adds a warning found during Why3 generation to the module's WhyRSettings, if it has any.
+     * Use this instead of adding to the warnings list directly; it is safe to call while goals are generated in parallel.
+     * See addGoals for details.
+     */
+    void addWhy3Warning(AnnotatedModule* module, whyr_warning warning);
     /**
      * Adds the imports needed to ensure no errors due to missing theories can occur.
      * Use getTypeInfo on the TypeInfo passed in first.
@@ -179,6 +304,11 @@ namespace whyr {
      * This version uses Why3Data, which pays attention to extra LogicExpression imports, among other things.
      */
     void addImports(ostream &out, Why3Data &data);
+    /**
+     * Like the above, but skips any theory already in 'added', and adds the ones it imports to it.
+     * Use this to import everything a theory needs once, at the top of the theory.
+     */
+    void addImports(ostream &out, Why3Data &data, unordered_set<string> &added);
     /**
      * Adds a constant of a LLVM integer type.
      * Note that the number you pass in is encoded as a string - this allows you to pass in arbitrary-precision numbers.
@@ -197,8 +327,9 @@ namespace whyr {
     void addOperand(ostream &out, AnnotatedModule* module, Value* operand, AnnotatedFunction* func = NULL);
     /**
      * Adds a basic block definition to a function theory.
+     * If goals is not NULL, every goal in it is selected by the 'goal_id' constant instead of by goalExpr and goalInst.
      */
-    void addBlock(ostream &out, AnnotatedFunction* func, BasicBlock* block, LogicExpression* goalExpr = NULL, Instruction* goalInst = NULL);
+    void addBlock(ostream &out, AnnotatedFunction* func, BasicBlock* block, LogicExpression* goalExpr = NULL, Instruction* goalInst = NULL, FunctionGoals* goals = NULL);
     /**
      * All branches need to imply the contents of their successor's phi instructions.
      * Call this function to add any implications necessary before implying the block predicate.
@@ -206,8 +337,18 @@ namespace whyr {
     void addWhy3PhiImplications(ostream &out, AnnotatedFunction* func, BasicBlock* block, BasicBlock* succ);
     /**
      * Adds the definition of an instruction to a basic block definition.
+     * If goals is not NULL, every goal in it is selected by the 'goal_id' constant instead of by goalExpr and goalInst.
      */
-    void addInstruction(ostream &out, AnnotatedFunction* func, Instruction* inst, LogicExpression* goalExpr = NULL, Instruction* goalInst = NULL);
+    void addInstruction(ostream &out, AnnotatedFunction* func, Instruction* inst, LogicExpression* goalExpr = NULL, Instruction* goalInst = NULL, FunctionGoals* goals = NULL);
+    /**
+     * Finds the imports and types the definition of an instruction needs, including its assert and assume clauses.
+     * addInstruction and addBlock do not add imports themselves; call this for each instruction first, and pass the result to addImports.
+     */
+    void getInstructionRequirements(Why3Data &data, AnnotatedFunction* func, Instruction* inst);
+    /**
+     * Calls getInstructionRequirements on every instruction in a block.
+     */
+    void getBlockRequirements(Why3Data &data, AnnotatedFunction* func, BasicBlock* block);
     /**
      * Adds a theory for modelling a function. No goals are generated.
      */
@@ -219,6 +360,16 @@ namespace whyr {
      * goalInst restricts the assertion to one specific instance, if not NULL.
      */
     void addGoal(ostream &out, AnnotatedFunction* func, string theoryName, LogicExpression* goalExpr, Instruction* goalInst);
+    /**
+     * Adds a theory containing the blocks of a function, with every goal in 'goals' guarded by the abstract constant 'goal_id'.
+     * Goal theories made with addSharedGoal clone this theory, so the blocks are emitted once per function rather than once per goal.
+     */
+    void addGoalBase(ostream &out, AnnotatedFunction* func, FunctionGoals &goals);
+    /**
+     * Adds a theory for a goal of a function, by cloning the function's goal base theory with 'goal_id' set to the goal's ID.
+     * Call addGoalBase for the function before calling this.
+     */
+    void addSharedGoal(ostream &out, AnnotatedFunction* func, GoalSite &goal);
     /**
      * Adds the base theory for all integer types.
      * This is not in the common header because it depends on the settings of the module.
@@ -298,11 +449,16 @@ namespace whyr {
     /**
      * Pass this function in an empty list for funcs.
      * This function will place in funcs all the functions that, when defined in Why3 in that order, will successfully depend on one another.
+     * If recursive is not NULL, each recursive or mutually recursive group of functions left out of funcs is appended to it,
+     * as is each group that calls into one of those, in the order they depend on one another.
      * TODO: What about recursion and mutual recursion?
      */
-    void getCorrectFunctionOrder(list<AnnotatedFunction*> &funcs, AnnotatedModule* mod);
+    void getCorrectFunctionOrder(list<AnnotatedFunction*> &funcs, AnnotatedModule* mod, list<list<AnnotatedFunction*>>* recursive = NULL);
     /**
      * This adds all the goals found in the program.
+     * If the module's WhyRSettings ask for more than one job, the goal theories are generated on that many threads.
+     * The output is the same as when they are generated one at a time.
+     * If the settings have a Why3Manifest, the goals of functions unchanged since it was saved are left out.
      */
     void addGoals(ostream &out, AnnotatedModule* module);
     /**
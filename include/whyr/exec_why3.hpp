@@ -13,6 +13,16 @@
  */
 
 #include "whyr.hpp"
+#include "output.hpp"
+
+#include <llvm/ADT/StringRef.h>
+
+#include <sstream>
+#include <mutex>
+#include <functional>
+#include <unordered_map>
+
+#include <sys/types.h>
 
 namespace whyr {
     using namespace std;
@@ -22,6 +32,8 @@ namespace whyr {
     static const string PROVER_Z3("z3");
     static const string PROVER_CVC4("cvc4");
     
+    class Why3ProofCache;
+    
     /// This represents a single why3 goal.
     struct Why3Goal {
         /// The theory the goal belongs to.
@@ -34,11 +46,93 @@ namespace whyr {
             STATUS_UNKNOWN,
             STATUS_FAIL,
             STATUS_TIMEOUT,
+            STATUS_OUT_OF_MEMORY,
         } status;
         /// The time, in seconds, for the goal to finish.
         double time;
         /// The number of steps it took to prove the goal. If the prover isn't alt-ergo, or the goal didn't pass, this will be -1.
         int steps = -1;
+        /// If true, this result came from a Why3ProofCache instead of a prover. See <whyr/proof_cache.hpp>.
+        bool cached = false;
+        /// When several provers raced on the goal, the one that gave this result. Empty otherwise.
+        string prover;
+    };
+    
+    /// This represents a single why3 goal as it is parsed. See class Why3OutputParser for details.
+    struct Why3GoalRef {
+        /// The theory the goal belongs to. Points into the parser's buffer.
+        StringRef theory;
+        /// The name of the goal. Points into the parser's buffer.
+        StringRef goal;
+        /// Whether or not the goal verified, failed, or timed out.
+        Why3Goal::Why3GoalStatus status;
+        /// The time, in seconds, for the goal to finish.
+        double time = 0;
+        /// The number of steps it took to prove the goal, or -1 if Why3 did not say.
+        int steps = -1;
+    };
+    
+    /**
+     * This parses the raw output of Why3 as it arrives, and calls a function for every goal as soon as its line is complete.
+     * Write the output to it as a streambuf, such as with Why3Process::setOutput, or pass it to feed.
+     * Only the line being parsed is kept, so memory use does not grow with the output.
+     * The Why3GoalRef given to the function points into a buffer that is reused for the next line, so copy anything kept from it.
+     */
+    class Why3OutputParser : public streambuf {
+    protected:
+        function<void(const Why3GoalRef&)> onGoal;
+        /// The output not yet parsed. Never holds more than one incomplete line once feed returns.
+        string buffer;
+        /// True if the last line was the location of an error or warning, and the next line says which.
+        bool sawLocation = false;
+        /// True after an error or a HighFailure, after which nothing more is parsed.
+        bool stopped = false;
+        /// The most bytes of otherLines to keep.
+        size_t otherLimit;
+        
+        void parseLine(StringRef line);
+        /**
+         * Adds a line that is not a goal's result to otherLines, if there is room for it.
+         */
+        void keepLine(StringRef line);
+        
+        virtual int_type overflow(int_type c);
+        virtual streamsize xsputn(const char* s, streamsize n);
+    public:
+        /// If true, Why3 reported an error in its input.
+        bool error = false;
+        /// The error message. Empty if error is false, or Why3 stopped before giving one.
+        string message;
+        /// The line the error occurred on. This value is undefined if error is false.
+        int line = -1;
+        /// The beginning and end columns the error occurred on. This value is undefined if error is false.
+        int colBegin = -1; int colEnd = -1;
+        /// Every line that was not a goal's result, such as warnings and errors, up to the limit given to the constructor.
+        string otherLines;
+        /// True if some line was left out of otherLines for lack of room.
+        bool otherLinesCut = false;
+        
+        /**
+         * otherLimit is how many bytes of lines that are not goal results to keep in otherLines. By default none are kept.
+         */
+        Why3OutputParser(function<void(const Why3GoalRef&)> onGoal, size_t otherLimit = 0);
+        
+        /**
+         * Parses the next n bytes of output. Goals whose lines are completed by them are reported before this returns.
+         */
+        void feed(const char* data, size_t n);
+        /**
+         * Parses whatever is left of the output once it has all arrived, such as a last line with no newline.
+         */
+        void finish();
+    };
+    
+    /// This limits the resources used to prove goals. A limit of 0 means there is no limit.
+    struct Why3Limits {
+        /// The time, in seconds, each goal may take.
+        unsigned time = 0;
+        /// The memory, in megabytes, each prover may use.
+        unsigned memory = 0;
     };
     
     /// This represents the whole output of a Why3 proving session.
@@ -58,15 +152,237 @@ namespace whyr {
          * str is the raw output of a why3 proof. Get this string via execWhy3.
          */
         Why3Output(const char* str);
+        /**
+         * Makes an output with no goals and no error. Use merge to fill it.
+         */
+        Why3Output();
         ~Why3Output();
+        
+        /**
+         * Moves all the goals of other onto the end of this output's goals.
+         * If other has an error and this output does not, the error is copied as well.
+         */
+        void merge(Why3Output &other);
+        /**
+         * Adds a goal from a Why3OutputParser, copying its names.
+         */
+        Why3Goal& addGoal(const Why3GoalRef &goal);
+        /**
+         * If the parser found an error, and this output has none, copies the error.
+         */
+        void addError(const Why3OutputParser &parser);
     };
     
+    /**
+     * This represents a running Why3 process.
+     * Write Why3 code to getInput() as it is generated, then call finish() to collect the raw output of Why3.
+     * The input is streamed to Why3 through a pipe, so it never has to be held in memory all at once.
+     * Output is read while the input is written, so Why3 never blocks on a full output pipe.
+     */
+    class Why3Process {
+    protected:
+        pid_t pid = -1;
+        DuplexStreamBuf* pipes = NULL;
+        ostream* input = NULL;
+        /// Output that arrived before anyone asked for it with setOutput.
+        stringbuf earlyOutput;
+        Why3Limits limits;
+        bool killed = false;
+        /// Held while reaping Why3, so cancel never signals a process ID that was already reused.
+        mutex lock;
+        bool exited = false;
+        /// True if cancel killed Why3, so being killed is no error.
+        bool cancelled = false;
+    public:
+        /**
+         * Starts Why3. Set checkOnly to true if you don't want to prove anything, only check the program is correct.
+         * prover is the prover you want to use. If not specified, defaults to Alt-Ergo.
+         * The limits are passed on to Why3, which holds each goal to them. The memory limit is also an rlimit on Why3 and its provers.
+         * If a time limit is given, finish kills Why3 once it goes too long without finishing a goal.
+         * Before the first goal, it gets longer the more input it was given, since it has to parse and type check it first.
+         */
+        Why3Process(bool checkOnly = false, const string &prover = PROVER_ALT_ERGO, const Why3Limits &limits = Why3Limits());
+        /**
+         * If finish was never called, this closes the input and waits for Why3 to exit, discarding its output.
+         */
+        ~Why3Process();
+        
+        /**
+         * Returns the stream to write Why3 code to. Only valid until finish is called.
+         */
+        ostream& getInput();
+        /**
+         * Sends the raw output of Why3 to out as it arrives, starting with any output already received.
+         * out must stay valid until finish returns.
+         */
+        void setOutput(ostream &out);
+        /**
+         * Ends the input, and places the raw output of Why3 into out. Returns when Why3 exits.
+         * Throws a whyr_exception if Why3 could not be run, was killed by anything but the watchdog or cancel,
+         * or exited with an error status without reporting an error in its input.
+         */
+        void finish(ostream &out);
+        /**
+         * After finish, returns true if Why3 was stopped for going over the time limit.
+         * The output will be missing the goals it did not get to.
+         */
+        bool hitTimeLimit();
+        /**
+         * Kills Why3 and its provers. finish still has to be called, and returns whatever output arrived before this.
+         * Unlike the other functions, this may be called from another thread while finish runs.
+         */
+        void cancel();
+    };
+    
+    /**
+     * Writes the result of a goal the way Why3 prints it after the goal's name, such as "Valid (0.25s, 12 steps)".
+     * Why3Output can read it back.
+     */
+    void writeWhy3GoalResult(ostream &out, const Why3Goal &goal);
+    
     /**
      * Takes a Why3-format string (NOT a filename!), and places the raw output of Why3 into out.
      * set checkOnly to true if you don't want to prove anything, only check the program is correct.
      * prover is the prover you want to use. If not specified, defaults to Alt-Ergo.
      */
-    void execWhy3(string &in, ostream &out, bool checkOnly = false, const string &prover = PROVER_ALT_ERGO);
+    void execWhy3(string &in, ostream &out, bool checkOnly = false, const string &prover = PROVER_ALT_ERGO, const Why3Limits &limits = Why3Limits());
+    
+    /**
+     * Splits Why3 code into tasks that can be proven independently of each other.
+     * Each theory containing goals becomes the last theory of its own task.
+     * It is preceded by every theory it uses or clones, directly or not, with their own goals removed.
+     * Tasks are added to the end of 'tasks', in the order their goals appear in the input.
+     */
+    void splitWhy3Tasks(const string &in, list<string> &tasks);
+    
+    /**
+     * Why3 code split into tasks, as by splitWhy3Tasks, any number of which can also be put together into a single batch.
+     * A batch is every theory the goals of its tasks use or clone, in the order of the input,
+     * keeping the goals of the tasks in the batch only. So a batch of one task is just that task.
+     */
+    class Why3TaskList {
+    protected:
+        /// A single theory of the input.
+        struct Theory {
+            string name;
+            /// The full text of the theory, including anything between it and the theory before it.
+            string text;
+            /// The text of the theory with all goals removed.
+            string withoutGoals;
+            bool hasGoals = false;
+            /// The index in theories of every theory this one uses or clones.
+            vector<size_t> uses;
+            /// The names of the goals of this theory, in order.
+            vector<string> goals;
+        };
+        
+        vector<Theory> theories;
+        /// The index in theories of the theory each task proves the goals of.
+        vector<size_t> goalTheories;
+        
+        /**
+         * Marks in 'needed' the theory a task proves the goals of, and every theory it uses or clones, directly or not.
+         */
+        void markClosure(size_t task, vector<char> &needed);
+    public:
+        Why3TaskList(const string &in);
+        
+        /**
+         * Returns the number of tasks.
+         */
+        size_t size();
+        /**
+         * Returns the text of a single task. This is its closure.
+         */
+        string getTask(size_t task);
+        /**
+         * Returns the theory a task proves the goals of, after every theory it uses or clones, directly or not, without their goals.
+         * This does not change when theories the goals cannot see do, so it is what the task's result depends on.
+         */
+        string getClosure(size_t task);
+        /**
+         * Returns the text of a batch of tasks.
+         */
+        string getBatch(const vector<size_t> &tasks);
+        /**
+         * Returns the name of the theory a task proves the goals of.
+         */
+        const string& getTheoryName(size_t task);
+        /**
+         * Returns the text of the theory a task proves the goals of, without the theories it uses.
+         * Its size is a cheap estimate of how hard the task is, since it grows with the number of blocks the goals reach.
+         */
+        const string& getTheoryText(size_t task);
+        /**
+         * Returns the names of the goals of a task, in order.
+         */
+        const vector<string>& getGoalNames(size_t task);
+    };
+    
+    /**
+     * The best result a portfolio of provers has given so far for each goal of a batch.
+     * A proof or disproof beats an unknown result, which beats a timeout, which beats anything else;
+     * between results that are as good, the first one given is kept.
+     * This is not thread-safe; the provers of a race share it under a lock.
+     */
+    class Why3PortfolioResults {
+    protected:
+        /// The best result for a single goal.
+        struct Entry {
+            string theory;
+            string goal;
+            bool found = false;
+            /// The result. Its theory and goal are left NULL; its prover is the prover that gave it.
+            Why3Goal result;
+        };
+        
+        vector<Entry> best;
+        /// The index in best of each goal, by theory and goal name separated by a space.
+        unordered_map<string, size_t> indices;
+        /// The number of goals proven or disproven.
+        size_t definite = 0;
+    public:
+        /**
+         * goals is the theory and name of every goal in the batch, in order.
+         */
+        Why3PortfolioResults(const vector<pair<string, string> > &goals);
+        
+        /**
+         * Keeps a result a prover gave for a goal, if it is better than the one kept so far. Goals not in the batch are ignored.
+         */
+        void add(const Why3GoalRef &goal, const string &prover);
+        /**
+         * Returns true if every goal is proven or disproven, so no other prover could do better.
+         */
+        bool isDecided();
+        /**
+         * Writes the kept results to out, the way Why3 would have, in the order of the goals.
+         * winners is set to the prover that gave each result, by goal name. Returns false if some goal has no result.
+         */
+        bool write(ostream &out, unordered_map<string, string> &winners);
+    };
+    
+    /**
+     * Proves Why3 code by splitting it with splitWhy3Tasks, and running up to 'jobs' Why3 processes at once.
+     * Tasks are packed into batches that share a Why3 process, sized by how long the tasks proven so far took for their size:
+     * small tasks are proven many at a time, and tasks expected to take long are proven alone.
+     * The goals of every task are merged into 'out' in the order they appear in the input.
+     * Only the goals are kept; of the rest of Why3's output, such as warnings and errors,
+     * a few kilobytes per task are kept and written to 'raw' in the same order.
+     * prover is the prover you want to use. If not specified, defaults to Alt-Ergo.
+     * If a batch is stopped for going over the time limit, the goals of the task that was stuck are reported as timed out,
+     * and the tasks after it in the batch are proven again, each alone.
+     * If cache is not NULL, tasks found in it are not proven again, and the results of the rest are added to it.
+     * module names the input the code was generated from, such as its file name, so the cache can tell goals of different inputs apart.
+     */
+    void proveWhy3Tasks(const string &in, Why3Output &out, ostream &raw, unsigned jobs, const string &prover = PROVER_ALT_ERGO, const Why3Limits &limits = Why3Limits(), Why3ProofCache* cache = NULL, const string &module = "");
+    /**
+     * Like the above, but races all the given provers on every task, as a portfolio.
+     * Each goal gets the best result any prover gave for it, and records that prover.
+     * The provers are killed once every goal of the batch is proven or disproven, or they all finish.
+     * If cache is not NULL, it also remembers the winner of each goal, and later runs give the prover that won the most goals of a batch a head start.
+     */
+    void proveWhy3Tasks(const string &in, Why3Output &out, ostream &raw, unsigned jobs, const vector<string> &provers, const Why3Limits &limits = Why3Limits(), Why3ProofCache* cache = NULL, const string &module = "");
 }
 
 #endif /* INCLUDE_WHYR_EXEC_WHY3_HPP_ */
@@ -98,6 +98,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -121,6 +122,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -143,6 +145,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -181,6 +184,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -204,6 +208,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -227,6 +232,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -246,6 +252,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -265,6 +272,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -295,6 +303,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -314,6 +323,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -333,6 +343,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -366,6 +377,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -387,6 +399,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -413,6 +426,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -432,6 +446,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -456,6 +471,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -481,6 +497,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -517,6 +534,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -547,6 +565,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -581,6 +600,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -600,6 +620,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -629,6 +650,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -657,6 +679,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -683,6 +706,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -703,6 +727,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -722,6 +747,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -742,6 +768,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -761,6 +788,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -780,6 +808,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -799,6 +828,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -839,6 +869,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -860,6 +891,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -882,6 +914,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -904,6 +937,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -927,6 +961,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -947,6 +982,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -967,6 +1003,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -987,6 +1024,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -1009,6 +1047,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -1030,6 +1069,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -1057,6 +1097,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -1078,6 +1119,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -1098,6 +1140,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -1120,6 +1163,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -1141,6 +1185,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -1162,6 +1207,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -1181,6 +1227,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -1201,6 +1248,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -1223,6 +1271,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -1245,6 +1294,7 @@ namespace whyr {
         virtual LogicType* returnType();
         virtual void checkTypes();
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicExpression* expr);
     };
@@ -57,6 +57,8 @@ namespace whyr {
         list<LogicDebugInfo> debugInfo;
         /// A label for this expression. Helps in Why3 generation and error generation.
         const char* label = NULL;
+        /// If false, ExpressionParser::parseTypeMetadata parses nodes anew rather than sharing them. Cleared beneath arguments whose type is freed by the expression using it.
+        bool shareTypes = true;
         
         NodeSource(AnnotatedFunction* func, Instruction* inst = NULL, Metadata* metadata = NULL);
         NodeSource(NodeSource* other);
@@ -112,6 +114,11 @@ namespace whyr {
          * This returns the Why3 full theory name of the type, appending it to the stream.
          */
         virtual void toWhy3(ostream &out, Why3Data &data);
+        /**
+         * This gathers the imports and type info this type needs in Why3 into data, without generating any Why3.
+         * Must have the same effect on data as toWhy3 does.
+         */
+        virtual void getRequirements(Why3Data &data);
         /**
          * We implement this function so we can use LLVM's casting functions on LogicType s,
          * which are isa, case, and dyn_cast. See the LLVm documentation for how to use those.
@@ -158,6 +165,11 @@ namespace whyr {
          * This converts the expression to Why3, appending it to the stream.
          */
         virtual void toWhy3(ostream &out, Why3Data &data);
+        /**
+         * This gathers the imports and type info this expression and its subexpressions need in Why3 into data, without generating any Why3.
+         * Use this instead of calling toWhy3 and discarding the output. Must have the same effect on data as toWhy3 does.
+         */
+        virtual void getRequirements(Why3Data &data);
         /**
          * We implement this function so we can use LLVM's casting functions on LogicType s,
          * which are isa, case, and dyn_cast. See the LLVm documentation for how to use those.
@@ -197,6 +209,16 @@ namespace whyr {
          * The caller owns the resulting LogicExpression. Free it when you are done.
          */
         static LogicExpression* parseMetadata(Metadata* node, NodeSource* source);
+        /**
+         * Call this function to convert a metadata node that is used only for its type into a WhyR expression,
+         * such as argument 1 of 'trunc', or the type of a logic-local.
+         * LLVM uniques metadata, so the same node often appears in many annotations of a function.
+         * The expression is kept in the function's module, and parsing the same node again returns it instead of parsing it anew.
+         * Nodes in the scope of a logic-local, or under a source with shareTypes cleared, are always parsed anew.
+         * 
+         * The AnnotatedModule of the source's function owns the resulting LogicExpression. Do not free it, or give it to an expression that will.
+         */
+        static LogicExpression* parseTypeMetadata(Metadata* node, NodeSource* source);
         
         ExpressionParser();
         virtual ~ExpressionParser();
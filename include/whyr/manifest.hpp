@@ -0,0 +1,105 @@
+/*
+ * manifest.hpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef INCLUDE_WHYR_MANIFEST_HPP_
+#define INCLUDE_WHYR_MANIFEST_HPP_
+
+/**
+ * This header contains a manifest of the functions proven on a previous run, so unchanged functions need not be generated or proven again.
+ */
+
+#include "esc_why3.hpp"
+#include "exec_why3.hpp"
+
+#include <llvm/IR/ModuleSlotTracker.h>
+
+#include <unordered_map>
+#include <unordered_set>
+#include <sstream>
+
+namespace whyr {
+    using namespace std;
+    using namespace llvm;
+    
+    /**
+     * A file recording, for each function, a fingerprint of everything its goals depend on, and the results of those goals.
+     * 
+     * A function's fingerprint covers its IR, its annotations, and the fingerprints of every function it calls,
+     * since a call clones the callee's whole theory into the caller's goals. Types and globals are covered too.
+     * When the fingerprint of a function matches the one saved, addGoals leaves out its goals, and the saved results are used instead.
+     * 
+     * Goals are identified by the function they belong to and their place in it, rather than their names,
+     * since goal names are numbered across the whole module, and change whenever a goal is added to an earlier function.
+     */
+    class Why3Manifest {
+    protected:
+        /// The saved state of one function.
+        struct Entry {
+            string fingerprint;
+            /// One line per goal result: the goal's ID, the suffix of the goal name after its theory name (or "-"), and the result.
+            list<string> results;
+        };
+        
+        string path;
+        /// Everything besides the module that goes into every fingerprint, such as settings that change the generated goals.
+        string context;
+        /// The fingerprint of the types and globals of the module. Empty until first computed.
+        string moduleFingerprint;
+        
+        /// The functions as they were saved, by name.
+        unordered_map<string, Entry> previous;
+        /// The functions as they will be saved, by name.
+        unordered_map<string, Entry> current;
+        /// The names of the functions checked this run, whether or not they changed.
+        unordered_set<string> seen;
+        /// Functions whose goals are being proven this run, by name, with the number of goals expected of them.
+        unordered_map<string, unsigned> pending;
+        /// Maps the theory name of each goal being proven this run to its function's name and its ID.
+        unordered_map<string, pair<string, unsigned>> goalSites;
+        /// The saved results of unchanged functions, in the format of Why3's raw output.
+        ostringstream reused;
+        
+        unordered_map<AnnotatedFunction*, string> fingerprints;
+        /// Numbers the values of the module for printing. NULL until the module fingerprint is first computed.
+        ModuleSlotTracker* slots;
+        
+        string getModuleFingerprint(AnnotatedModule* module);
+    public:
+        /**
+         * Loads the manifest in the given file, if it exists.
+         * context should describe every setting that changes the goals or how they are proven, such as the prover and limits.
+         * If it differs from the one saved, every function is treated as changed.
+         */
+        Why3Manifest(const string &path, const string &context);
+        ~Why3Manifest();
+        
+        /**
+         * Returns a hash of everything the goals of a function depend on. Only call this from one thread at a time.
+         */
+        string getFingerprint(AnnotatedFunction* func);
+        /**
+         * Called by addGoals for each function with goals. Only call this from one thread at a time.
+         * If the function is unchanged since the manifest was saved, returns true, and its saved results are kept for getReusedResults.
+         * Otherwise, returns false, and the goals are remembered so their results can be matched up by addResults.
+         */
+        bool checkFunction(AnnotatedFunction* func, FunctionGoals &goals);
+        /**
+         * Records the results of proving the goals of changed functions.
+         * A function is only recorded once every one of its goals has a result.
+         */
+        void addResults(Why3Output &results);
+        /**
+         * Adds the saved results of every unchanged function to out, marked as cached.
+         */
+        void getReusedResults(Why3Output &out);
+        /**
+         * Writes the manifest back to its file. Functions not checked this run keep the results saved for them.
+         */
+        void save();
+    };
+}
+
+#endif /* INCLUDE_WHYR_MANIFEST_HPP_ */
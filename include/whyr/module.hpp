@@ -15,6 +15,8 @@
 
 #include "logic.hpp"
 
+#include <tuple>
+
 namespace whyr {
     using namespace std;
     using namespace llvm;
@@ -22,6 +24,8 @@ namespace whyr {
     class AnnotatedFunction;
     class AnnotatedModule;
     class AnnotatedInstruction;
+    class FunctionLayout;
+    class NameMangler;
     
     /**
      * This represents a single LLVM instruction, with added WhyR annotations.
@@ -107,10 +111,22 @@ namespace whyr {
         bool hasAssgins = false;
         list<LogicExpression*> assigns;
         list<AnnotatedInstruction*> annotatedInsts;
+        /// Maps each Instruction to its entry in annotatedInsts. Covers the first annotatedInstsIndexed entries of the list.
+        unordered_map<Instruction*, AnnotatedInstruction*> annotatedInstsIndex;
+        size_t annotatedInstsIndexed = 0;
+        FunctionLayout* layout = NULL;
+        TypeInfo* typeInfo = NULL;
     public:
         AnnotatedFunction(AnnotatedModule* module, Function* llvm);
         ~AnnotatedFunction();
         
+        /**
+         * Brings the index getAnnotatedInstruction looks instructions up in up to date with the list of annotated instructions.
+         * Instructions are usually appended to the list via getAnnotatedInstructions, so only the new entries are indexed.
+         * getAnnotatedInstruction calls this for you; call it first if getAnnotatedInstruction is to be called from several threads at once.
+         */
+        void indexAnnotatedInstructions();
+        
         /**
          * Constructing an AnnotatedFunction does not annotate it.
          * Call this function so it can parse any attached nodes, such as requires clauses or ensures clauses.
@@ -161,6 +177,26 @@ namespace whyr {
          * This object owns the resulting AnnotatedInstruction. It will free it on deletion.
          */
         AnnotatedInstruction* getAnnotatedInstruction(Instruction* inst);
+        /**
+         * Returns the layout of this function's instructions, as used by Why3 generation. See "esc_why3.hpp" for details.
+         * The layout is built the first time this is called.
+         * 
+         * This object owns the resulting FunctionLayout. It will free it on deletion.
+         */
+        FunctionLayout* getLayout();
+        /**
+         * Returns the type information of this function, as found by computeTypeInfo. See "esc_why3.hpp" for details.
+         * The type information is computed the first time this is called, and kept until invalidateTypeInfo is called.
+         * 
+         * This object owns the resulting TypeInfo. It will free it on deletion or invalidation.
+         */
+        TypeInfo* getTypeInfo();
+        /**
+         * Discards the cached type information of this function and its module.
+         * Call this whenever the annotations of the function or its instructions change.
+         * AnnotatedInstruction::setAssertClause and AnnotatedInstruction::setAssumeClause call this for you.
+         */
+        void invalidateTypeInfo();
     };
     
     /**
@@ -170,14 +206,36 @@ namespace whyr {
     protected:
         unique_ptr<Module> llvm;
         list<AnnotatedFunction*> functions;
+        /// Maps each Function and function name to its entry in functions. Covers the first functionsIndexed entries of the list.
+        unordered_map<Function*, AnnotatedFunction*> functionsIndex;
+        unordered_map<string, AnnotatedFunction*> functionNamesIndex;
+        size_t functionsIndexed = 0;
         WhyRSettings* settings;
+        TypeInfo* typeInfo = NULL;
+        NameMangler* names;
+        /// Expressions parsed by ExpressionParser::parseTypeMetadata, keyed by node, function, and whether they are in a function contract.
+        map<tuple<Metadata*, AnnotatedFunction*, bool>, LogicExpression*> parsedTypes;
+        /// The functions the function filters select. Empty if there are no filters.
+        unordered_set<Function*> selected;
     public:
         AnnotatedModule(unique_ptr<Module>& llvm, WhyRSettings* settings = NULL);
         ~AnnotatedModule();
         
+        /**
+         * Brings the indices getFunction looks functions up in up to date with the list of functions.
+         * Only the entries appended to the list since the last call are indexed.
+         * getFunction calls this for you; call it first if getFunction is to be called from several threads at once.
+         */
+        void indexFunctions();
+        
         /**
          * Constructing an AnnotatedModule does not annotate it.
          * Call this function so it can parse any attached functions.
+         * 
+         * If the settings have function filters, only the functions they select, and the functions those refer to, are annotated.
+         * Every other function has no AnnotatedFunction, and is left out of type discovery and Why3 generation.
+         * The functions referred to but not selected have their bodies deleted from the LLVM module, so only their contracts are emitted.
+         * Functions whose blocks are addressed keep their bodies, but are still not selected. See isSelected.
          */
         void annotate();
         /**
@@ -214,11 +272,41 @@ namespace whyr {
          * It will only free it after this AnnotatedModule is deleted.
          */
         WhyRSettings* getSettings();
+        /**
+         * Returns true if the goals of a function are to be generated: that is, if the function filters select it, or there are none.
+         * Call annotate() first.
+         */
+        bool isSelected(Function* func);
+        /**
+         * Returns the type information of this module, as found by computeTypeInfo. See "esc_why3.hpp" for details.
+         * The type information is computed the first time this is called, and kept until invalidateTypeInfo is called.
+         * 
+         * This object owns the resulting TypeInfo. It will free it on deletion or invalidation.
+         */
+        TypeInfo* getTypeInfo();
+        /**
+         * Discards the cached type information of this module.
+         * AnnotatedFunction::invalidateTypeInfo calls this for you.
+         */
+        void invalidateTypeInfo();
+        /**
+         * Returns the NameMangler holding the Why3 names of this module's values. See "esc_why3.hpp" for details.
+         * 
+         * This object owns the resulting NameMangler. It will free it on deletion.
+         */
+        NameMangler* getNameMangler();
+        /**
+         * Returns the expressions already parsed by ExpressionParser::parseTypeMetadata in this module. See "parser.cpp" for details.
+         * 
+         * This object owns the resulting map, and all values. It will free them on deletion.
+         */
+        map<tuple<Metadata*, AnnotatedFunction*, bool>, LogicExpression*>* getParsedTypes();
         
         /**
          * Retrieves a module from an input stream consisting of LLVM bitcode.
          * Returns NULL if something went wrong.
          * file_name is important only for debug information.
+         * This reads the whole stream into memory first; to load a file, use moduleFromBitcodeFile instead.
          * 
          * The caller owns the resulting AnnotatedModule. Free it when you are done.
          */
@@ -227,10 +315,25 @@ namespace whyr {
          * Retrieves a module from an input stream consisting of LLVM IR.
          * Returns NULL if something went wrong.
          * file_name is important only for debug information.
+         * This reads the whole stream into memory first; to load a file, use moduleFromIRFile instead.
          * 
          * The caller owns the resulting AnnotatedModule. Free it when you are done.
          */
         static AnnotatedModule* moduleFromIR(istream& file, const char* file_name, WhyRSettings* settings = NULL);
+        /**
+         * Retrieves a module from a file of LLVM bitcode, which is mapped into memory rather than copied.
+         * Returns NULL if something went wrong.
+         * 
+         * The caller owns the resulting AnnotatedModule. Free it when you are done.
+         */
+        static AnnotatedModule* moduleFromBitcodeFile(const char* file_name, WhyRSettings* settings = NULL);
+        /**
+         * Retrieves a module from a file of LLVM IR, which is mapped into memory rather than copied.
+         * Returns NULL if something went wrong.
+         * 
+         * The caller owns the resulting AnnotatedModule. Free it when you are done.
+         */
+        static AnnotatedModule* moduleFromIRFile(const char* file_name, WhyRSettings* settings = NULL);
     };
 }
 
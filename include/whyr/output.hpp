@@ -0,0 +1,180 @@
+/*
+ * output.hpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef INCLUDE_WHYR_OUTPUT_HPP_
+#define INCLUDE_WHYR_OUTPUT_HPP_
+
+/**
+ * This header contains output sinks for generated Why3 code.
+ * Generation writes to an ostream, so any of these can be passed to generateWhy3 directly,
+ * and the output is written out as it is generated instead of being held in memory.
+ * To keep output in memory instead, use an ostringstream.
+ */
+
+#include "whyr.hpp"
+
+#include <streambuf>
+#include <ostream>
+#include <unordered_map>
+
+namespace whyr {
+    using namespace std;
+    using namespace llvm;
+    
+    /**
+     * A stream buffer that writes to a file descriptor, such as a file or a pipe to another process.
+     * Output is buffered, and memory use is bounded by the buffer size no matter how much is written.
+     */
+    class FdStreamBuf : public streambuf {
+    protected:
+        int fd;
+        bool ownsFd;
+        vector<char> buffer;
+        
+        /**
+         * Writes everything currently in the buffer to the file descriptor.
+         * Returns false if the write failed, such as if the other end of a pipe was closed.
+         */
+        virtual bool flushBuffer();
+        virtual int_type overflow(int_type c);
+        virtual int sync();
+    public:
+        /**
+         * If ownsFd is true, the file descriptor will be closed when this object is closed or deleted.
+         */
+        FdStreamBuf(int fd, bool ownsFd = false, size_t bufferSize = 65536);
+        virtual ~FdStreamBuf();
+        
+        /**
+         * Returns the file descriptor being written to, or -1 if it has been closed.
+         */
+        int getFd();
+        /**
+         * Flushes the buffer, and closes the file descriptor if this object owns it.
+         * Nothing may be written after this is called.
+         */
+        void close();
+    };
+    
+    /**
+     * A stream buffer that writes to the input of another process, and reads the output of that process at the same time.
+     * A process that fills its output pipe stops reading its input until the output is read,
+     * so writing all the input before reading any output can deadlock.
+     * Output is passed to the sink as soon as it arrives.
+     */
+    class DuplexStreamBuf : public FdStreamBuf {
+    protected:
+        int readFd;
+        streambuf* sink;
+        vector<char> readBuffer;
+        bool idle = false;
+        /// The number of bytes written to the process so far.
+        size_t written = 0;
+        /// True once any output has been read from the process.
+        bool sawOutput = false;
+        
+        /**
+         * Waits until the input can be written to or there is output to read, and reads the output if there is any.
+         * If wantWrite is false, only waits for output. Returns false if something went wrong.
+         * Sets readFd to -1 once the process closes its output.
+         * If nothing happens for timeout milliseconds, sets idle and returns. A negative timeout waits forever.
+         */
+        bool poll(bool wantWrite, bool &canWrite, int timeout = -1);
+        virtual bool flushBuffer();
+    public:
+        /**
+         * writeFd is the input of the process, and readFd its output. This object owns both file descriptors.
+         * The caller keeps ownership of the sink, and must keep it alive until the output is closed or the sink is changed.
+         */
+        DuplexStreamBuf(int writeFd, int readFd, streambuf* sink, size_t bufferSize = 65536);
+        virtual ~DuplexStreamBuf();
+        
+        /**
+         * Changes where output read from now on goes.
+         */
+        void setSink(streambuf* sink);
+        /**
+         * Reads output until the process closes it, then closes it on our end as well.
+         * Close the input first, or the process may never finish. Returns false if reading failed.
+         * If idleTimeout is not negative, this also gives up and returns false once no output arrives for that many milliseconds.
+         * If firstTimeout is not negative, it is used instead of idleTimeout until the process gives its first output.
+         */
+        bool readAll(int idleTimeout = -1, int firstTimeout = -1);
+        /**
+         * Returns the number of bytes written to the process so far.
+         */
+        size_t getBytesWritten();
+        /**
+         * Returns true if the last readAll gave up because no output arrived in time.
+         */
+        bool timedOut();
+    };
+    
+    /**
+     * A stream buffer that copies everything written to it into two other stream buffers.
+     * It does no buffering of its own.
+     */
+    class TeeStreamBuf : public streambuf {
+    protected:
+        streambuf* first;
+        streambuf* second;
+        
+        virtual int_type overflow(int_type c);
+        virtual streamsize xsputn(const char* s, streamsize n);
+        virtual int sync();
+    public:
+        /**
+         * The caller keeps ownership of both stream buffers, and must keep them alive as long as this object.
+         */
+        TeeStreamBuf(streambuf* first, streambuf* second);
+    };
+    
+    /**
+     * A stream buffer that discards Why3 code written to it, but counts the bytes of each theory in it.
+     * Pair it with a TeeStreamBuf to measure code as it is written elsewhere.
+     */
+    class TheorySizeStreamBuf : public streambuf {
+    protected:
+        unordered_map<string, size_t> sizes;
+        /// The start of the current line, kept whole only if it is a theory header.
+        string line;
+        size_t lineLength = 0;
+        /// The size of the theory being written, or NULL between theories.
+        size_t* current = NULL;
+        
+        virtual int_type overflow(int_type c);
+        virtual streamsize xsputn(const char* s, streamsize n);
+    public:
+        /**
+         * Returns the size in bytes of the theory with the given name, from its header to its "end", or 0 if it was never written.
+         */
+        size_t getSize(const string &theory) const;
+    };
+    
+    /**
+     * An ostream writing to a file descriptor through a FdStreamBuf.
+     */
+    class FdOstream : public ostream {
+    protected:
+        FdStreamBuf buf;
+    public:
+        /**
+         * If ownsFd is true, the file descriptor will be closed when this object is closed or deleted.
+         */
+        FdOstream(int fd, bool ownsFd = false, size_t bufferSize = 65536);
+        
+        /**
+         * Returns the file descriptor being written to, or -1 if it has been closed.
+         */
+        int getFd();
+        /**
+         * Flushes the stream, and closes the file descriptor if this object owns it.
+         */
+        void close();
+    };
+}
+
+#endif /* INCLUDE_WHYR_OUTPUT_HPP_ */
@@ -0,0 +1,71 @@
+/*
+ * proof_cache.hpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef INCLUDE_WHYR_PROOF_CACHE_HPP_
+#define INCLUDE_WHYR_PROOF_CACHE_HPP_
+
+/**
+ * This header contains an on-disk cache of proof results, so unchanged goals need not be proven again.
+ */
+
+#include "exec_why3.hpp"
+
+namespace whyr {
+    using namespace std;
+    using namespace llvm;
+    
+    /**
+     * A directory of proof results, one file per task as made by splitWhy3Tasks.
+     * Each file is named after a hash of everything that could change the result of the task:
+     * the theories the task's goals can see (see Why3TaskList::getClosure), the prover, the versions of Why3 and its provers, and the limits.
+     * 
+     * Several processes may use the same directory at once. Results are written to a temporary file first,
+     * then renamed into place, so a result is never seen half written.
+     */
+    class Why3ProofCache {
+    protected:
+        string dir;
+        /// Everything besides the task that goes into the hash.
+        string proverInfo;
+        
+        /**
+         * Returns the file the winner of a goal is kept in, named after a hash of the module, theory, and goal names.
+         */
+        string getWinnerPath(const string &module, const string &theory, const string &goal);
+    public:
+        /**
+         * Uses the cache in the given directory, creating it if it doesn't exist.
+         * This runs Why3 once to find out what versions of the provers are installed.
+         */
+        Why3ProofCache(const string &dir, const string &prover, const Why3Limits &limits);
+        
+        /**
+         * Returns the key a task's result is stored under. task is the text its result depends on, such as from Why3TaskList::getClosure.
+         */
+        string getKey(const string &task);
+        /**
+         * Looks up the result of a task. If it is cached, places it into out in the format of Why3's raw output, and returns true.
+         */
+        bool lookup(const string &key, string &out);
+        /**
+         * Stores the result of a task. Results with errors are not stored.
+         * Only store a result that has every goal of the task, or the missing goals will never be proven.
+         */
+        void store(const string &key, Why3Output &result);
+        /**
+         * Returns the prover that last proved or disproved the given goal first in a portfolio race, or an empty string if none did.
+         * A goal is known by the module it is in, such as the name of its input file, and the names of its theory and itself.
+         * Unlike results, this is kept even when the goal changes, since a similar goal is likely won by the same prover.
+         */
+        string getWinner(const string &module, const string &theory, const string &goal);
+        /**
+         * Remembers the prover that won a portfolio race on the given goal.
+         */
+        void setWinner(const string &module, const string &theory, const string &goal, const string &prover);
+    };
+}
+
+#endif /* INCLUDE_WHYR_PROOF_CACHE_HPP_ */
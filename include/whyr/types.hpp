@@ -50,6 +50,7 @@ namespace whyr {
         virtual string toString();
         virtual bool equals(LogicType* other);
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicType* type);
     };
@@ -65,6 +66,7 @@ namespace whyr {
         virtual string toString();
         virtual bool equals(LogicType* other);
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicType* type);
     };
@@ -83,6 +85,7 @@ namespace whyr {
         virtual string toString();
         virtual bool equals(LogicType* other);
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicType* type);
     };
@@ -117,6 +120,7 @@ namespace whyr {
         virtual string toString();
         virtual bool equals(LogicType* other);
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicType* type);
     };
@@ -132,6 +136,7 @@ namespace whyr {
         virtual string toString();
         virtual bool equals(LogicType* other);
         virtual void toWhy3(ostream &out, Why3Data &data);
+        virtual void getRequirements(Why3Data &data);
         
         static bool classof(const LogicType* type);
     };
@@ -20,6 +20,9 @@ namespace whyr {
     using namespace std;
     using namespace llvm;
     
+    /**
+     * Parses a WAR expression. The parser is not reentrant, so calls from several threads at once take turns.
+     */
     LogicExpression* parseWarString(string war, NodeSource* source);
 }
 
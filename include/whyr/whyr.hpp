@@ -36,7 +36,7 @@ namespace whyr {
     using namespace std;
     using namespace llvm;
     
-    class whyr_exception; class whyr_warning;
+    class whyr_exception; class whyr_warning; class Why3Manifest;
     
     /// This is the WhyR version string. Update it for new releases.
     #define WHYR_VERSION "0.4.1"
@@ -89,8 +89,24 @@ namespace whyr {
         bool noGoals = false;
         /// If true, all goals are combined instead of split and copied.
         bool combineGoals = false;
+        /// If true, each function's blocks are emitted once into a goal base theory, and every goal theory clones it instead of copying it.
+        bool sharedGoals = false;
         /// If true, add vacuous checks- Goals that try to prove false. Used for finding contradictions in logic.
         bool vacuousChecks = false;
+        /// The number of threads goal theories are generated on. See addGoals in <whyr/esc_why3.hpp> for details.
+        unsigned jobs = 1;
+        /// The time, in seconds, each goal may take to prove. 0 means no limit. See Why3Limits in <whyr/exec_why3.hpp> for details.
+        unsigned proverTimeLimit = 0;
+        /// The memory, in megabytes, each prover may use. 0 means no limit.
+        unsigned proverMemLimit = 0;
+        /// If not empty, the directory proof results are cached in. See <whyr/proof_cache.hpp> for details.
+        string proofCache;
+        /// If not NULL, functions unchanged since this manifest was saved have no goals generated. See <whyr/manifest.hpp> for details.
+        Why3Manifest* manifest = NULL;
+        /// If true, bitcode is loaded lazily, and only annotated functions and the functions they reach are given bodies. The rest are made declarations.
+        bool lazyLoad = false;
+        /// If not empty, only functions whose whole names match one of these regular expressions are verified, and only the contracts of the functions they call are emitted. See AnnotatedModule::annotate in <whyr/module.hpp> for details.
+        list<string> functionFilters;
     };
 }
 
@@ -0,0 +1,57 @@
+/*
+ * workers.hpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef INCLUDE_WHYR_WORKERS_HPP_
+#define INCLUDE_WHYR_WORKERS_HPP_
+
+/**
+ * This header contains the pool of threads WhyR runs independent pieces of work on, such as goals, tasks, and input files.
+ */
+
+#include "whyr.hpp"
+
+#include <functional>
+#include <thread>
+#include <atomic>
+
+namespace whyr {
+    using namespace std;
+    using namespace llvm;
+    
+    /**
+     * A number of threads that run a function on every index from 0 to a count.
+     * Each thread takes the next index not yet started, so a slow index never holds up the others.
+     * The threads start at once, so the thread that made the pool is free to collect results while they run.
+     */
+    class WorkerPool {
+    protected:
+        function<void(size_t)> work;
+        size_t count;
+        atomic<size_t> next;
+        vector<thread> workers;
+    public:
+        /**
+         * Starts up to 'jobs' threads, but no more than count, running work on every index below count.
+         * work must not throw; catch anything it might throw, and keep it with the index's result.
+         */
+        WorkerPool(unsigned jobs, size_t count, function<void(size_t)> work);
+        /**
+         * Waits for the threads to finish.
+         */
+        ~WorkerPool();
+        
+        /**
+         * Makes sure no index not yet started ever is. Indices already running still finish.
+         */
+        void stop();
+        /**
+         * Waits until every started index is done, and the threads have exited.
+         */
+        void join();
+    };
+}
+
+#endif /* INCLUDE_WHYR_WORKERS_HPP_ */
@@ -8,9 +8,14 @@
 #include <whyr/esc_why3.hpp>
 #include <whyr/exception.hpp>
 #include <whyr/types.hpp>
+#include <whyr/manifest.hpp>
+#include <whyr/workers.hpp>
 
 #include <cmath>
 #include <sstream>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
 
 namespace whyr {
     using namespace std;
@@ -44,7 +49,7 @@ namespace whyr {
         } else {
             // give a warning
             if (info.module && info.module->getSettings()) {
-                info.module->getSettings()->warnings.push_back(whyr_warning("found unknown type in input"));
+                addWhy3Warning(info.module, whyr_warning("found unknown type in input"));
             } else {
                 // Can't warn. We have no output channel to do it in without crashing.
             }
@@ -135,6 +140,10 @@ namespace whyr {
     }
     
     void getTypeInfo(TypeInfo &info, AnnotatedFunction* func) {
+        getTypeInfo(info, *func->getTypeInfo());
+    }
+    
+    void computeTypeInfo(TypeInfo &info, AnnotatedFunction* func) {
         // Set the module we're looking at
         info.module = func->getModule();
         
@@ -156,51 +165,49 @@ namespace whyr {
         
         // If we have a requires/ensures clause, it may need to import more types
         if (func->getRequiresClause()) {
-            ostringstream discarded; // FIXME: this is not an efficient way to discard stream data. We need a custom ostream subclass.
-            
             Why3Data data;
             data.module = func->getModule();
             data.source = new NodeSource(func);
             data.info = &info;
             
-            func->getRequiresClause()->toWhy3(discarded, data);
+            func->getRequiresClause()->getRequirements(data);
         }
         
         if (func->getEnsuresClause()) {
-            ostringstream discarded; // FIXME: this is not an efficient way to discard stream data. We need a custom ostream subclass.
-            
             Why3Data data;
             data.module = func->getModule();
             data.source = new NodeSource(func);
             data.info = &info;
             
-            func->getEnsuresClause()->toWhy3(discarded, data);
+            func->getEnsuresClause()->getRequirements(data);
         }
         
         // For every instruction with annotations, gather info about thier assert/assume clauses
         for (list<AnnotatedInstruction*>::iterator ii = func->getAnnotatedInstructions()->begin(); ii != func->getAnnotatedInstructions()->end(); ii++) {
-            ostringstream discarded;
-            
             Why3Data data;
             data.module = func->getModule();
             data.source = new NodeSource(func);
             data.info = &info;
             
             if ((*ii)->getAssertClause()) {
-                (*ii)->getAssertClause()->toWhy3(discarded, data);
+                (*ii)->getAssertClause()->getRequirements(data);
             }
             
             if ((*ii)->getAssumeClause()) {
-                (*ii)->getAssumeClause()->toWhy3(discarded, data);
+                (*ii)->getAssumeClause()->getRequirements(data);
             }
         }
     }
     
     void getTypeInfo(TypeInfo &info, AnnotatedModule* module) {
+        getTypeInfo(info, *module->getTypeInfo());
+    }
+    
+    void computeTypeInfo(TypeInfo &info, AnnotatedModule* module) {
         // Set the module we're looking at
         info.module = module;
         
-        // Gather info about all the functions in the module
+        // Gather info about all the functions in the module, using their cached info
         list<AnnotatedFunction*>* a = module->getFunctions();
         for (list<AnnotatedFunction*>::iterator ii = a->begin(); ii != a->end(); ii++) {
             getTypeInfo(info, *ii);
@@ -216,28 +223,177 @@ namespace whyr {
         info.module = other.module;
         info.intTypes.insert(other.intTypes.begin(), other.intTypes.end());
         info.ptrTypes.insert(other.ptrTypes.begin(), other.ptrTypes.end());
+        info.floatTypes.insert(other.floatTypes.begin(), other.floatTypes.end());
+        info.arrayTypes.insert(other.arrayTypes.begin(), other.arrayTypes.end());
+        info.structTypes.insert(other.structTypes.begin(), other.structTypes.end());
+        info.vectorTypes.insert(other.vectorTypes.begin(), other.vectorTypes.end());
         info.funcsCalled.insert(other.funcsCalled.begin(), other.funcsCalled.end());
         info.globalsUsed.insert(other.globalsUsed.begin(), other.globalsUsed.end());
         info.usesAlloc = info.usesAlloc | other.usesAlloc;
+        info.locals.insert(other.locals.begin(), other.locals.end());
+        info.statepoints.insert(other.statepoints.begin(), other.statepoints.end());
+        info.usesBaddr = info.usesBaddr | other.usesBaddr;
+    }
+    
+    /*
+     * GOAL DISCOVERY
+     */
+    
+    unsigned FunctionGoals::getID(LogicExpression* goalExpr, Instruction* goalInst) {
+        if (!goalExpr) {
+            return 0;
+        }
+        
+        map<pair<Instruction*, LogicExpression*>, unsigned>::iterator ii = ids.find(make_pair(goalInst, goalExpr));
+        if (ii == ids.end()) {
+            return 0;
+        }
+        return ii->second;
+    }
+    
+    static void addGoalSite(FunctionGoals &goals, string theoryName, LogicExpression* goalExpr, Instruction* goalInst) {
+        GoalSite site;
+        site.theoryName = theoryName;
+        site.goalExpr = goalExpr;
+        site.goalInst = goalInst;
+        site.id = goals.sites.size() + 1;
+        
+        goals.sites.push_back(site);
+        goals.ids[make_pair(goalInst, goalExpr)] = site.id;
+    }
+    
+    void getFunctionGoals(FunctionGoals &goals, AnnotatedFunction* func, unsigned &asserts, unsigned &calls) {
+        string funcName = getWhy3SafeName(string(func->rawIR()->getName().data()));
+        
+        if (func->getEnsuresClause()) {
+            addGoalSite(goals, "Goal_" + funcName + "_ensures", func->getEnsuresClause(), NULL);
+        }
+        
+        for (Function::iterator jj = func->rawIR()->begin(); jj != func->rawIR()->end(); jj++) {
+            for (BasicBlock::iterator kk = jj->begin(); kk != jj->end(); kk++) {
+                AnnotatedInstruction* inst = func->getAnnotatedInstruction(&*kk);
+                if (inst && inst->getAssertClause()) {
+                    string goalName = "Goal_" + funcName + "_assert_";
+                    if (inst->getAssertClause()->getSource() && inst->getAssertClause()->getSource()->label) {
+                        goalName += inst->getAssertClause()->getSource()->label;
+                    }
+                    goalName += "_" + to_string(asserts);
+                    addGoalSite(goals, goalName, inst->getAssertClause(), &*kk);
+                    asserts++;
+                }
+                
+                if (isa<CallInst>(&*kk)) {
+                    CallInst* callInst = cast<CallInst>(&*kk);
+                    Function* calledFuncRaw = callInst->getCalledFunction();
+                    if (!calledFuncRaw) continue;
+                    AnnotatedFunction* calledFunc = func->getModule()->getFunction(calledFuncRaw);
+                    
+                    if (calledFunc && calledFunc->getRequiresClause()) {
+                        string goalName = "Goal_" + funcName + "_call_" + getWhy3SafeName(string(calledFuncRaw->getName().data())) + "_" + to_string(calls);
+                        addGoalSite(goals, goalName, calledFunc->getRequiresClause(), &*kk);
+                        calls++;
+                    }
+                }
+            }
+        }
+    }
+    
+    /*
+     * FUNCTION LAYOUT
+     */
+    
+    FunctionLayout::FunctionLayout(AnnotatedFunction* func) {
+        for (Function::iterator ii = func->rawIR()->begin(); ii != func->rawIR()->end(); ii++) {
+            BasicBlock* block = &*ii;
+            string blockName = getWhy3BlockName(func, block);
+            
+            string state = "entry_state";
+            if (&func->rawIR()->getEntryBlock() != block) {
+                state = getWhy3StatepointBeforeBlock(func, block);
+            }
+            
+            unsigned inst_no = 1;
+            for (BasicBlock::iterator jj = block->begin(); jj != block->end(); jj++) {
+                InstructionLayout &layout = insts[&*jj];
+                layout.statementName = blockName + "_" + jj->getOpcodeName() + "_" + to_string(inst_no);
+                layout.statepointBefore = state;
+                
+                // instructions that change the state introduce a new statepoint for the instructions after them
+                switch (jj->getOpcode()) {
+                    case Instruction::MemoryOps::Store:
+                    case Instruction::MemoryOps::Alloca:
+                    case Instruction::OtherOps::Call: {
+                        state = "state_after_" + blockName + "_" + jj->getOpcodeName() + "_" + getTempName(func->getModule(), &*jj);
+                        break;
+                    }
+                    default: {
+                        // do nothing
+                    }
+                }
+                
+                inst_no++;
+            }
+        }
+    }
+    
+    InstructionLayout& FunctionLayout::getInstruction(Instruction* inst) {
+        unordered_map<Instruction*, InstructionLayout>::iterator ii = insts.find(inst);
+        if (ii == insts.end()) {
+            throw whyr_exception("Internal error: in FunctionLayout: inst not part of function!");
+        }
+        return ii->second;
     }
     
     /*
      * NAME MANGLER
      */
     
-    static unordered_map<void*, string> temp_names;
-    static int temp_name_counter = 0;
-    string getTempName(void* p) {
-        unordered_map<void*, string>::iterator ii = temp_names.find(p);
-        if (ii == temp_names.end()) {
-            string name = to_string(temp_name_counter++);
-            temp_names[p] = name;
-            return name;
+    string NameMangler::getTempName(const void* p) {
+        if (sealed) {
+            // tempNames no longer changes, so it can be read from any number of threads at once
+            unordered_map<const void*, unsigned>::iterator ii = tempNames.find(p);
+            if (ii == tempNames.end()) {
+                // a name given out now would depend on the order the goal theories happen to be generated in
+                throw whyr_exception("internal error: temporary name needed after goal generation started");
+            }
+            return to_string(ii->second);
+        }
+        
+        lock_guard<mutex> guard(lock);
+        unordered_map<const void*, unsigned>::iterator ii = tempNames.find(p);
+        if (ii == tempNames.end()) {
+            unsigned id = tempNameCounter++;
+            tempNames[p] = id;
+            return to_string(id);
+        } else {
+            return to_string(ii->second);
+        }
+    }
+    
+    void NameMangler::seal() {
+        sealed = true;
+    }
+    
+    string NameMangler::getVarName(Value* var) {
+        if (var->hasName()) {
+            return string("val_") + getWhy3SafeName(var->getName().data());
         } else {
-            return ii->second;
+            return string("val_") + getTempName(var);
         }
     }
     
+    string NameMangler::getBlockName(BasicBlock* block) {
+        if (block->hasName()) {
+            return "b_" + getWhy3SafeName(string(block->getName().data()));
+        } else {
+            return "b_" + getTempName(block);
+        }
+    }
+    
+    string getTempName(AnnotatedModule* module, void* p) {
+        return module->getNameMangler()->getTempName(p);
+    }
+    
     string getWhy3SafeName(string name) {
         ostringstream out;
         bool onlyNumbers = true;
@@ -334,36 +490,24 @@ namespace whyr {
         return "Function_" + getWhy3SafeName(string(func->rawIR()->getName().data()));
     }
     
-    string getWhy3VarName(Value* var) {
-        string name;
-        
-        if (var->hasName()) {
-            name = getWhy3SafeName(var->getName().data());
-        } else {
-            name = getTempName(var);
-        }
-        
-        return string("val_") + name;
+    string getWhy3GoalBaseTheoryName(AnnotatedFunction* func) {
+        return "GoalBase_" + getWhy3SafeName(string(func->rawIR()->getName().data()));
+    }
+    
+    string getWhy3VarName(AnnotatedModule* module, Value* var) {
+        return module->getNameMangler()->getVarName(var);
     }
     
-    string getWhy3ArgName(string callee, Value* var) {
-        return "arg_" + getWhy3SafeName(callee) + "_" + getWhy3SafeName(getWhy3VarName(var));
+    string getWhy3ArgName(AnnotatedModule* module, string callee, Value* var) {
+        return "arg_" + getWhy3SafeName(callee) + "_" + getWhy3SafeName(getWhy3VarName(module, var));
     }
     
     string getWhy3BlockName(AnnotatedFunction* func, BasicBlock* block) {
-        if (block->hasName()) {
-            return "b_" + getWhy3SafeName(string(block->getName().data()));
-        }
-        return "b_" + getTempName(block);
+        return func->getModule()->getNameMangler()->getBlockName(block);
     }
     
     string getWhy3StatementName(AnnotatedFunction* func, Instruction* inst) {
-        unsigned inst_no = 1;
-        for (BasicBlock::iterator ii = inst->getParent()->begin(); ii != inst->getParent()->end(); ii++) {
-            if (&*ii == inst) break;
-            inst_no++;
-        }
-        return getWhy3BlockName(func, inst->getParent()) + "_" + inst->getOpcodeName() + "_" + to_string(inst_no);
+        return func->getLayout()->getInstruction(inst).statementName;
     }
     
     string getWhy3LocalName(LogicLocal* local) {
@@ -375,31 +519,7 @@ namespace whyr {
     }
     
     string getWhy3StatepointBefore(AnnotatedFunction* func, Instruction* inst) {
-        BasicBlock* block = inst->getParent();
-        
-        string state = "entry_state";
-        if (&func->rawIR()->getEntryBlock() != block) {
-            state = getWhy3StatepointBeforeBlock(func, block);
-        }
-        
-        for (BasicBlock::iterator ii = block->begin(); ii != block->end(); ii++) {
-            if (&*ii == inst) {
-                return state;
-            }
-            switch (ii->getOpcode()) {
-                case Instruction::MemoryOps::Store:
-                case Instruction::MemoryOps::Alloca:
-                case Instruction::OtherOps::Call: {
-                    state = "state_after_" + getWhy3BlockName(func, block) + "_" + ii->getOpcodeName() + "_" + getTempName(&*ii);
-                    break;
-                }
-                default: {
-                    // do nothing
-                }
-            }
-        }
-        
-        throw whyr_exception("Internal error: in getWhy3StatepointBefore: inst not part of parent block!");
+        return func->getLayout()->getInstruction(inst).statepointBefore;
     }
     
     string getWhy3GlobalName(GlobalVariable* global) {
@@ -450,6 +570,17 @@ theory Range
 end
 )";
 
+    /// While a goal is generated on a worker thread, its warnings are kept here, so they can be added in order once all goals are done.
+    static thread_local list<whyr_warning>* goal_warnings = NULL;
+    
+    void addWhy3Warning(AnnotatedModule* module, whyr_warning warning) {
+        if (goal_warnings) {
+            goal_warnings->push_back(warning);
+        } else if (module && module->getSettings()) {
+            module->getSettings()->warnings.push_back(warning);
+        }
+    }
+    
     void addImports(ostream &out, NodeSource* source, TypeInfo &info) {
         // This is a wrapper around the Why3Data version of this function.
         Why3Data data;
@@ -460,38 +591,52 @@ end
         addImports(out, data);
     }
     
+    /**
+     * Writes a single import, unless it is already in the given set of imports.
+     */
+    static void addImport(ostream &out, unordered_set<string> &added, const string &theory) {
+        if (added.insert(theory).second) {
+            out << "    use import " << theory << endl;
+        }
+    }
+    
     void addImports(ostream &out, Why3Data &data) {
+        unordered_set<string> added;
+        addImports(out, data, added);
+    }
+    
+    void addImports(ostream &out, Why3Data &data, unordered_set<string> &added) {
         // we need these for pretty much all arithmetic; so just include them by default
-        out << "    use import int.Int" << endl;
-        out << "    use import real.RealInfix" << endl;
+        addImport(out, added, "int.Int");
+        addImport(out, added, "real.RealInfix");
         // for each field in TypeInfo, add the relevant asserts.
         for (unordered_set<IntegerType*>::iterator ii = data.info->intTypes.begin(); ii != data.info->intTypes.end(); ii++) {
-            out << "    use import " << getWhy3TheoryName(*ii) << endl;
+            addImport(out, added, getWhy3TheoryName(*ii));
         }
         for (unordered_set<PointerType*>::iterator ii = data.info->ptrTypes.begin(); ii != data.info->ptrTypes.end(); ii++) {
-            out << "    use import " << getWhy3TheoryName(*ii) << endl;
+            addImport(out, added, getWhy3TheoryName(*ii));
         }
         for (unordered_set<Type*>::iterator ii = data.info->floatTypes.begin(); ii != data.info->floatTypes.end(); ii++) {
-            out << "    use import " << getWhy3TheoryName(*ii) << endl;
+            addImport(out, added, getWhy3TheoryName(*ii));
         }
         for (unordered_set<ArrayType*>::iterator ii = data.info->arrayTypes.begin(); ii != data.info->arrayTypes.end(); ii++) {
-            out << "    use import " << getWhy3TheoryName(*ii) << endl;
+            addImport(out, added, getWhy3TheoryName(*ii));
         }
         for (unordered_set<StructType*>::iterator ii = data.info->structTypes.begin(); ii != data.info->structTypes.end(); ii++) {
-            out << "    use import " << getWhy3TheoryName(*ii) << endl;
+            addImport(out, added, getWhy3TheoryName(*ii));
         }
         for (unordered_set<VectorType*>::iterator ii = data.info->vectorTypes.begin(); ii != data.info->vectorTypes.end(); ii++) {
-            out << "    use import " << getWhy3TheoryName(*ii) << endl;
+            addImport(out, added, getWhy3TheoryName(*ii));
         }
         if (data.info->usesAlloc) {
-            out << "    use import Alloc" << endl;
+            addImport(out, added, "Alloc");
         }
         if (data.info->usesBaddr) {
-            out << "    use import BlockAddress" << endl;
+            addImport(out, added, "BlockAddress");
         }
         // Why3Data also includes needed import information.
         for (unordered_set<string>::iterator ii = data.importsNeeded.begin(); ii != data.importsNeeded.end(); ii++) {
-            out << "    use import " << *ii << endl;
+            addImport(out, added, *ii);
         }
     }
     
@@ -511,6 +656,16 @@ end
         }
     }
     
+    /**
+     * Returns true if addOperand writes a value as a variable named by getWhy3VarName, rather than as a constant.
+     * This is every value but those addOperand has a case for.
+     */
+    static bool isWhy3Variable(Value* operand) {
+        return !isa<GlobalValue>(operand) && !isa<ConstantInt>(operand) && !isa<ConstantFP>(operand) && !isa<ConstantArray>(operand) && !isa<ConstantDataArray>(operand)
+                && !isa<ConstantStruct>(operand) && !isa<ConstantAggregateZero>(operand) && !isa<ConstantPointerNull>(operand) && !isa<BlockAddress>(operand)
+                && !isa<ConstantVector>(operand) && !isa<ConstantDataVector>(operand);
+    }
+    
     void addOperand(ostream &out, AnnotatedModule* module, Value* operand, AnnotatedFunction* func) {
         // TODO: add handlers for different subclasses of Constant, etc.
         if (isa<GlobalValue>(operand)) {
@@ -638,8 +793,8 @@ end
                 out << "]";
             }
         } else {
-            // Else, if it is a local variable...
-            out << getWhy3VarName(operand);
+            // Else, if it is a local variable, or anything else isWhy3Variable accepts...
+            out << getWhy3VarName(module, operand);
         }
     }
     
@@ -656,9 +811,7 @@ end
         }
     }
     
-    void addInstruction(ostream &out, AnnotatedFunction* func, Instruction* inst, LogicExpression* goalExpr, Instruction* goalInst) {
-        bool combineGoals = (func->getModule()->getSettings() && func->getModule()->getSettings()->combineGoals);
-        
+    void getInstructionRequirements(Why3Data &data, AnnotatedFunction* func, Instruction* inst) {
         switch (inst->getOpcode()) {
             case Instruction::BinaryOps::FAdd:
             case Instruction::BinaryOps::FSub:
@@ -667,19 +820,19 @@ end
             case Instruction::BinaryOps::FRem:
             case Instruction::CastOps::FPTrunc:
             case Instruction::CastOps::FPExt: {
-                out << "    use import floating_point.Rounding" << endl;
+                data.importsNeeded.insert("floating_point.Rounding");
                 break;
             }
             case Instruction::CastOps::FPToUI:
             case Instruction::CastOps::FPToSI: {
-                out << "    use import floating_point.Rounding" << endl;
-                out << "    use import CustomTruncate" << endl;
+                data.importsNeeded.insert("floating_point.Rounding");
+                data.importsNeeded.insert("CustomTruncate");
                 break;
             }
             case Instruction::CastOps::UIToFP:
             case Instruction::CastOps::SIToFP: {
-                out << "    use import floating_point.Rounding" << endl;
-                out << "    use import real.FromInt" << endl;
+                data.importsNeeded.insert("floating_point.Rounding");
+                data.importsNeeded.insert("real.FromInt");
                 break;
             }
             case Instruction::CastOps::PtrToInt:
@@ -690,21 +843,62 @@ end
                     ptrIntType = VectorType::get(ptrIntType, inst->getType()->getVectorNumElements());
                 }
                 
-                out << "    use import " << getWhy3TheoryName(ptrIntType) << endl;
+                data.importsNeeded.insert(getWhy3TheoryName(ptrIntType));
                 break;
             }
             case Instruction::MemoryOps::GetElementPtr:
             case Instruction::CastOps::BitCast: {
-                out << "    use import Pointer" << endl;
+                data.importsNeeded.insert("Pointer");
                 break;
             }
+            case Instruction::OtherOps::Call: {
+                // if the callee has an assigns clause, we need to import what it needs
+                AnnotatedFunction* calledFunc = func->getModule()->getFunction(cast<CallInst>(inst)->getCalledFunction());
+                if (calledFunc && calledFunc->getAssignsLocations()) {
+                    for (list<LogicExpression*>::iterator ii = calledFunc->getAssignsLocations()->begin(); ii != calledFunc->getAssignsLocations()->end(); ii++) {
+                        (*ii)->getRequirements(data);
+                    }
+                }
+                break;
+            }
+            case Instruction::CastOps::Trunc: {
+                data.importsNeeded.insert("int.ComputerDivision");
+                break;
+            }
+            default: {
+                // do nothing
+            }
+        }
+        
+        // assert and assume clauses
+        AnnotatedInstruction* annotated = func->getAnnotatedInstruction(inst);
+        if (annotated) {
+            if (annotated->getAssumeClause()) {
+                annotated->getAssumeClause()->getRequirements(data);
+            }
+            if (annotated->getAssertClause()) {
+                annotated->getAssertClause()->getRequirements(data);
+            }
+        }
+    }
+    
+    void getBlockRequirements(Why3Data &data, AnnotatedFunction* func, BasicBlock* block) {
+        for (BasicBlock::iterator ii = block->begin(); ii != block->end(); ii++) {
+            getInstructionRequirements(data, func, &*ii);
+        }
+    }
+    
+    void addInstruction(ostream &out, AnnotatedFunction* func, Instruction* inst, LogicExpression* goalExpr, Instruction* goalInst, FunctionGoals* goals) {
+        bool combineGoals = (func->getModule()->getSettings() && func->getModule()->getSettings()->combineGoals);
+        
+        switch (inst->getOpcode()) {
             case Instruction::OtherOps::Call: {
                 CallInst* callInst = cast<CallInst>(inst);
                 Function* calledFuncRaw = callInst->getCalledFunction();
                 if (!calledFuncRaw) {
                     // give a warning
                     if (func->getModule()->getSettings()) {
-                        func->getModule()->getSettings()->warnings.push_back(whyr_warning("indirect calls currently unsupported; call instruction ignored", NULL, new NodeSource(func, inst)));
+                        addWhy3Warning(func->getModule(), whyr_warning("indirect calls currently unsupported; call instruction ignored", NULL, new NodeSource(func, inst)));
                     } else {
                         // Can't warn. We have no output channel to do it in without crashing.
                     }
@@ -720,12 +914,12 @@ end
                     // should never get here, but who knows
                     throw whyr_exception(("internal error: function " + string(calledFuncRaw->getName().data()) + " not found in module"), NULL, new NodeSource(func, inst));
                 }
-                string calleeTheoryName = getWhy3TheoryName(calledFunc) + "_call_" + getTempName(inst);
+                string calleeTheoryName = getWhy3TheoryName(calledFunc) + "_call_" + getTempName(func->getModule(), inst);
                 
                 unsigned i;
                 i = 0;
                 for (Function::ArgumentListType::iterator ii = calledFuncRaw->getArgumentList().begin(); ii != calledFuncRaw->getArgumentList().end(); ii++) {
-                    out << "    constant " << getWhy3ArgName(calleeTheoryName, &*ii) << " : " << getWhy3FullName(ii->getType()) << " = ";
+                    out << "    constant " << getWhy3ArgName(func->getModule(), calleeTheoryName, &*ii) << " : " << getWhy3FullName(ii->getType()) << " = ";
                     addOperand(out, func->getModule(), callInst->getArgOperand(i), func);
                     out << endl;
                     i++;
@@ -736,7 +930,7 @@ end
                     i = 0;
                     for (Function::ArgumentListType::iterator ii = calledFuncRaw->getArgumentList().begin(); ii != calledFuncRaw->getArgumentList().end(); ii++) {
                         if (i) out << "," << endl;
-                        out << "            constant " << getWhy3VarName(&*ii) << " = " << getWhy3ArgName(calleeTheoryName, &*ii);
+                        out << "            constant " << getWhy3VarName(func->getModule(), &*ii) << " = " << getWhy3ArgName(func->getModule(), calleeTheoryName, &*ii);
                         i++;
                     }
                     out << "," << endl << "            constant entry_state = " << getWhy3StatepointBefore(func, inst) << endl;
@@ -745,27 +939,6 @@ end
                 }
                 out << "    end" << endl;
                 
-                // if we have an assigns clause, we need to import what it needs
-                if (calledFunc->getAssignsLocations()) {
-                    TypeInfo info;
-                    Why3Data data;
-                    data.module = func->getModule();
-                    data.source = new NodeSource(func, inst);
-                    data.info = &info;
-                    data.statepoint = getWhy3StatepointBefore(func, inst);
-                    
-                    ostringstream discarded;
-                    for (list<LogicExpression*>::iterator ii = calledFunc->getAssignsLocations()->begin(); ii != calledFunc->getAssignsLocations()->end(); ii++) {
-                        (*ii)->toWhy3(discarded, data);
-                    }
-                    
-                    addImports(out, data);
-                }
-                
-                break;
-            }
-            case Instruction::CastOps::Trunc: {
-                out << "    use import int.ComputerDivision" << endl;
                 break;
             }
             default: {
@@ -796,16 +969,27 @@ end
                 break;
             }
             case Instruction::TermOps::Ret: {
-                if (func->rawIR()->getReturnType()->isVoidTy()) {
-                    out << "exit_state = " << getWhy3StatepointBefore(func, inst) << " -> function_ensures";
-                } else {
+                if (!func->rawIR()->getReturnType()->isVoidTy()) {
                     out << "ret_val = ";
                     addOperand(out, func->getModule(), inst->getOperand(0), func);
-                    out << " -> exit_state = " << getWhy3StatepointBefore(func, inst) << " -> function_ensures";
+                    out << " -> ";
                 }
+                out << "exit_state = " << getWhy3StatepointBefore(func, inst) << " -> ";
                 
-                if (!combineGoals && goalExpr != func->getEnsuresClause()) {
-                    out << " -> true";
+                if (goals) {
+                    // the ensures clause only needs to hold if it is the selected goal
+                    unsigned id = goals->getID(func->getEnsuresClause(), NULL);
+                    if (id) {
+                        out << "(goal_id = " << id << " -> function_ensures)";
+                    } else {
+                        out << "function_ensures -> true";
+                    }
+                } else {
+                    out << "function_ensures";
+                    
+                    if (!combineGoals && goalExpr != func->getEnsuresClause()) {
+                        out << " -> true";
+                    }
                 }
                 break;
             }
@@ -1658,9 +1842,17 @@ end
                 CallInst* callInst = cast<CallInst>(inst);
                 Function* calledFuncRaw = callInst->getCalledFunction();
                 AnnotatedFunction* calledFunc = func->getModule()->getFunction(calledFuncRaw);
-                string calleeTheoryName = getWhy3TheoryName(calledFunc) + "_call_" + getTempName(inst);
+                string calleeTheoryName = getWhy3TheoryName(calledFunc) + "_call_" + getTempName(func->getModule(), inst);
                 
-                if (!combineGoals && (goalInst != inst || goalExpr != calledFunc->getRequiresClause())) {
+                if (goals) {
+                    // the callee's requires clause is proven instead of assumed if it is the selected goal
+                    unsigned id = goals->getID(calledFunc->getRequiresClause(), inst);
+                    if (id) {
+                        out << "(goal_id = " << id << " \\/ " << calleeTheoryName << ".F.function_requires) -> ";
+                    } else {
+                        out << calleeTheoryName << ".F.function_requires -> ";
+                    }
+                } else if (!combineGoals && (goalInst != inst || goalExpr != calledFunc->getRequiresClause())) {
                     out << calleeTheoryName << ".F.function_requires -> ";
                 }
                 
@@ -1705,7 +1897,7 @@ end
             default: {
                 // give a warning
                 if (func->getModule()->getSettings()) {
-                    func->getModule()->getSettings()->warnings.push_back(whyr_warning(("Unknown opcode; instruction ignored"), NULL, new NodeSource(func, inst)));
+                    addWhy3Warning(func->getModule(), whyr_warning(("Unknown opcode; instruction ignored"), NULL, new NodeSource(func, inst)));
                 } else {
                     // Can't warn. We have no output channel to do it in without crashing.
                 }
@@ -1723,42 +1915,12 @@ end
         }
     }
     
-    void addBlock(ostream &out, AnnotatedFunction* func, BasicBlock* block, LogicExpression* goalExpr, Instruction* goalInst) {
+    void addBlock(ostream &out, AnnotatedFunction* func, BasicBlock* block, LogicExpression* goalExpr, Instruction* goalInst, FunctionGoals* goals) {
         for (BasicBlock::iterator ii = block->begin(); ii != block->end(); ii++) {
-            addInstruction(out, func, &*ii, goalExpr, goalInst);
+            addInstruction(out, func, &*ii, goalExpr, goalInst, goals);
         }
         
-        // gather imports for assert/assume
-        ostringstream clause_stream;
         bool combineGoals = (func->getModule()->getSettings() && func->getModule()->getSettings()->combineGoals);
-        for (BasicBlock::iterator ii = block->begin(); ii != block->end(); ii++) {
-            AnnotatedInstruction* inst = func->getAnnotatedInstruction(&*ii);
-            if (inst) {
-                TypeInfo info;
-                Why3Data data;
-                data.module = func->getModule();
-                data.source = new NodeSource(func, &*ii);
-                data.info = &info;
-                data.statepoint = getWhy3StatepointBefore(func, &*ii);
-                
-                if (inst->getAssumeClause()) {
-                    inst->getAssumeClause()->toWhy3(clause_stream, data);
-                    
-                    for (unordered_set<string>::iterator ii = data.importsNeeded.begin(); ii != data.importsNeeded.end(); ii++) {
-                        out << "    use import " << *ii << endl;
-                    }
-                }
-                
-                if (inst->getAssertClause()) {
-                    inst->getAssertClause()->toWhy3(clause_stream, data);
-                    
-                    for (unordered_set<string>::iterator ii = data.importsNeeded.begin(); ii != data.importsNeeded.end(); ii++) {
-                        out << "    use import " << *ii << endl;
-                    }
-                }
-            }
-        }
-        
         out << "    axiom " << getWhy3BlockName(func, block) << ": " << getWhy3BlockName(func, block) << " = (";
         
         bool first = true;
@@ -1787,7 +1949,16 @@ end
                 }
                 
                 if (inst->getAssertClause()) {
-                    if (combineGoals || (goalInst == &*ii && goalExpr == inst->getAssertClause())) {
+                    unsigned id = goals ? goals->getID(inst->getAssertClause(), &*ii) : 0;
+                    if (id) {
+                        // (goal_id = N -> A) /\ (A -> ...) is (A /\ ...) when selected, and (A -> ...) otherwise
+                        out << "((goal_id = " << id << " -> ";
+                        inst->getAssertClause()->toWhy3(out, data);
+                        out << ") /\\ (";
+                        inst->getAssertClause()->toWhy3(out, data);
+                        out << " -> ";
+                        parens+=2;
+                    } else if (!goals && (combineGoals || (goalInst == &*ii && goalExpr == inst->getAssertClause()))) {
                         out << "(";
                         inst->getAssertClause()->toWhy3(out, data);
                         out << " /\\ (";
@@ -1800,11 +1971,32 @@ end
             }
             
             // add requires clause for function calls, if needed
-            if (goalInst == &*ii && isa<CallInst>(&*ii)) {
+            if (goals && isa<CallInst>(&*ii) && cast<CallInst>(&*ii)->getCalledFunction()) {
+                CallInst* callInst = cast<CallInst>(&*ii);
+                Function* calledFuncRaw = callInst->getCalledFunction();
+                AnnotatedFunction* calledFunc = func->getModule()->getFunction(calledFuncRaw);
+                
+                unsigned id = calledFunc ? goals->getID(calledFunc->getRequiresClause(), &*ii) : 0;
+                if (id) {
+                    TypeInfo info;
+                    Why3Data data;
+                    data.module = func->getModule();
+                    data.source = new NodeSource(func, &*ii);
+                    data.info = &info;
+                    data.statepoint = getWhy3StatepointBefore(func, &*ii);
+                    string calleeTheoryName = getWhy3TheoryName(calledFunc) + "_call_" + getTempName(func->getModule(), &*ii);
+                    data.calleeTheoryName = calleeTheoryName.c_str();
+                    
+                    out << "((goal_id = " << id << " -> ";
+                    calledFunc->getRequiresClause()->toWhy3(out, data);
+                    out << ") /\\ (";
+                    parens+=2;
+                }
+            } else if (goalInst == &*ii && isa<CallInst>(&*ii)) {
                 CallInst* callInst = cast<CallInst>(&*ii);
                 Function* calledFuncRaw = callInst->getCalledFunction();
                 AnnotatedFunction* calledFunc = func->getModule()->getFunction(calledFuncRaw);
-                string calleeTheoryName = getWhy3TheoryName(calledFunc) + "_call_" + getTempName(&*ii);
+                string calleeTheoryName = getWhy3TheoryName(calledFunc) + "_call_" + getTempName(func->getModule(), &*ii);
                 
                 if (combineGoals || (calledFunc->getRequiresClause() && goalExpr == calledFunc->getRequiresClause())) {
                     TypeInfo info;
@@ -1837,15 +2029,44 @@ end
         addGoal(out, func, getWhy3TheoryName(func), NULL, NULL);
     }
     
-    void addGoal(ostream &out, AnnotatedFunction* func, string theoryName, LogicExpression* goalExpr, Instruction* goalInst) {
-        out << "theory " << theoryName << endl;
-        TypeInfo info;
-        getTypeInfo(info, func);
-        addImports(out, new NodeSource(func), info);
+    /**
+     * Adds everything in a function theory between the theory header and the goals: imports, constants, clauses, and blocks.
+     */
+    static void addFunctionBody(ostream &out, AnnotatedFunction* func, LogicExpression* goalExpr, Instruction* goalInst, FunctionGoals* goals) {
+        // this is the same for every goal of the function, so use the cached version instead of a copy
+        TypeInfo &info = *func->getTypeInfo();
+        // The cached info already covers the clauses, and may be shared between threads; render them against this instead.
+        TypeInfo clauseInfo;
+        clauseInfo.module = func->getModule();
+        
+        // everything the clauses and blocks need is imported here, once, rather than next to each use
+        unordered_set<string> imports;
+        Why3Data infoData;
+        infoData.module = func->getModule();
+        infoData.source = new NodeSource(func);
+        infoData.info = &info;
+        addImports(out, infoData, imports);
+        addImport(out, imports, "State");
+        addImport(out, imports, "Globals");
+        
+        TypeInfo bodyInfo;
+        bodyInfo.module = func->getModule();
+        Why3Data bodyData;
+        bodyData.module = func->getModule();
+        bodyData.source = new NodeSource(func);
+        bodyData.info = &bodyInfo;
+        if (func->getRequiresClause()) {
+            func->getRequiresClause()->getRequirements(bodyData);
+        }
+        if (func->getEnsuresClause()) {
+            func->getEnsuresClause()->getRequirements(bodyData);
+        }
+        for (Function::iterator ii = func->rawIR()->begin(); ii != func->rawIR()->end(); ii++) {
+            getBlockRequirements(bodyData, func, &*ii);
+        }
+        addImports(out, bodyData, imports);
         
         // add statepoints
-        out << "    use import State" << endl;
-        out << "    use import Globals" << endl;
         if (func->rawIR()->isDeclaration()) {
             out << "    constant entry_state : state" << endl;
         } else {
@@ -1856,7 +2077,7 @@ end
         out << "    constant exit_state : state" << endl;
         // add constants
         for (unordered_set<Value*>::iterator ii = info.locals.begin(); ii != info.locals.end(); ii++) {
-            out << "    constant " << getWhy3VarName(*ii) << " : " << getWhy3FullName((*ii)->getType()) << endl;
+            out << "    constant " << getWhy3VarName(func->getModule(), *ii) << " : " << getWhy3FullName((*ii)->getType()) << endl;
         }
         if (!func->rawIR()->getReturnType()->isVoidTy()) {
             out << "    constant ret_val : " << getWhy3FullName(func->rawIR()->getReturnType()) << endl;
@@ -1872,13 +2093,10 @@ end
             Why3Data data;
             data.module = func->getModule();
             data.source = new NodeSource(func);
-            data.info = &info;
+            data.info = &clauseInfo;
             data.statepoint = "entry_state";
             
             func->getRequiresClause()->toWhy3(clause_stream, data);
-            for (unordered_set<string>::iterator ii = data.importsNeeded.begin(); ii != data.importsNeeded.end(); ii++) {
-                out << "    use import " << *ii << endl;
-            }
             out << "    predicate function_requires = " << clause_stream.str();
             
             out << endl;
@@ -1892,13 +2110,10 @@ end
             Why3Data data;
             data.module = func->getModule();
             data.source = new NodeSource(func);
-            data.info = &info;
+            data.info = &clauseInfo;
             data.statepoint = "exit_state";
             
             func->getEnsuresClause()->toWhy3(clause_stream, data);
-            for (unordered_set<string>::iterator ii = data.importsNeeded.begin(); ii != data.importsNeeded.end(); ii++) {
-                out << "    use import " << *ii << endl;
-            }
             out << "    predicate function_ensures = " << clause_stream.str();
             
             out << endl;
@@ -1915,11 +2130,16 @@ end
         
         // build each block
         for (Function::iterator ii = func->rawIR()->begin(); ii != func->rawIR()->end(); ii++) {
-            addBlock(out, func, &*ii, goalExpr, goalInst);
+            addBlock(out, func, &*ii, goalExpr, goalInst, goals);
         }
+    }
+    
+    void addGoal(ostream &out, AnnotatedFunction* func, string theoryName, LogicExpression* goalExpr, Instruction* goalInst) {
+        out << "theory " << theoryName << endl;
+        addFunctionBody(out, func, goalExpr, goalInst, NULL);
         
-        // add the goal, if we have one
-        if ((func->getModule()->getSettings() && func->getModule()->getSettings()->combineGoals) || goalExpr) {
+        // add the goal, if we have one; in combined goal mode, every selected function's theory is its goal
+        if ((func->getModule()->getSettings() && func->getModule()->getSettings()->combineGoals && func->getModule()->isSelected(func->rawIR())) || goalExpr) {
             out << "    goal " << theoryName << ": function_requires -> execute" << endl;
             
             if (func->getModule()->getSettings() && func->getModule()->getSettings()->vacuousChecks) {
@@ -1929,6 +2149,26 @@ end
         out << "end" << endl << endl;
     }
     
+    void addGoalBase(ostream &out, AnnotatedFunction* func, FunctionGoals &goals) {
+        out << "theory " << getWhy3GoalBaseTheoryName(func) << endl;
+        // every goal theory cloning this sets goal_id to select which clause it proves
+        out << "    constant goal_id : int" << endl;
+        addFunctionBody(out, func, NULL, NULL, &goals);
+        out << "end" << endl << endl;
+    }
+    
+    void addSharedGoal(ostream &out, AnnotatedFunction* func, GoalSite &goal) {
+        out << "theory " << goal.theoryName << endl;
+        out << "    constant selected_goal : int = " << goal.id << endl;
+        out << "    clone import " << getWhy3GoalBaseTheoryName(func) << " with constant goal_id = selected_goal" << endl;
+        out << "    goal " << goal.theoryName << ": function_requires -> execute" << endl;
+        
+        if (func->getModule()->getSettings() && func->getModule()->getSettings()->vacuousChecks) {
+            out << "    goal " << goal.theoryName << "_vacuous: (function_requires /\\ execute) -> false" << endl;
+        }
+        out << "end" << endl << endl;
+    }
+    
     void addCommonIntType(ostream &out, AnnotatedModule* module) {
         out << "theory LLVMInt" << endl;
         if (!module->getSettings() || module->getSettings()->why3IntMode == WhyRSettings::WHY3_INT_MODE_INT) {
@@ -2667,132 +2907,429 @@ end
         }
     }
     
-    void getCorrectDerivedTypeOrder(list<Type*> &types, TypeInfo &info, AnnotatedModule* mod) {
-        unordered_set<Type*> notSeen;
-        notSeen.insert(info.ptrTypes.begin(), info.ptrTypes.end());
-        notSeen.insert(info.arrayTypes.begin(), info.arrayTypes.end());
-        notSeen.insert(info.structTypes.begin(), info.structTypes.end());
-        notSeen.insert(info.vectorTypes.begin(), info.vectorTypes.end());
-        
-        // while there's still more nodes in need of calculation; that is, if the state changed since last iteration...
-        bool changed;
-        do {
-            changed = false;
-            
-            for (unordered_set<Type*>::iterator ii = notSeen.begin(); ii != notSeen.end(); /* ii++ is below */) {
+    /**
+     * Orders nodes so that every node comes after the nodes it depends on, using Tarjan's strongly connected components algorithm.
+     * Runs in time linear to the number of nodes and dependencies. Dependencies not found in deps are assumed to already be satisfied.
+     * Strongly connected components that are cyclic, or that depend on a cyclic component, cannot be ordered.
+     * They are placed in ignored instead, one list per component, in dependency order.
+     */
+    template<typename T> static void getDependencyOrder(list<T> &nodes, unordered_map<T, list<T>> &deps, list<T> &order, list<list<T>> &ignored) {
+        struct NodeState {
+            /// The order this node was visited in, starting at 1. 0 if not yet visited.
+            unsigned index = 0;
+            unsigned lowlink = 0;
+            bool onStack = false;
+            bool ignored = false;
+        };
+        unordered_map<T, NodeState> states;
+        for (typename list<T>::iterator ii = nodes.begin(); ii != nodes.end(); ii++) {
+            states[*ii];
+        }
+        
+        unsigned nextIndex = 1;
+        list<T> sccStack;
+        // the DFS is done with an explicit stack, as call chains can be deeper than the native stack allows
+        list<pair<T, typename list<T>::iterator>> work;
+        for (typename list<T>::iterator ii = nodes.begin(); ii != nodes.end(); ii++) {
+            if (states[*ii].index) continue;
+            
+            states[*ii].index = states[*ii].lowlink = nextIndex++;
+            states[*ii].onStack = true;
+            sccStack.push_back(*ii);
+            work.push_back(make_pair(*ii, deps[*ii].begin()));
+            
+            while (!work.empty()) {
+                T node = work.back().first;
+                NodeState &state = states[node];
                 
-                // if all dependancy nodes have been seen, then we are ready to add to the list.
-                // Note that this means nodes with no dependencies automatically pass the test.
-                bool allSeen = true;
-                if ((*ii)->isPointerTy()) {
-                    if (notSeen.find((*ii)->getPointerElementType()) != notSeen.end()) {
-                        allSeen = false;
-                    }
-                } else if ((*ii)->isArrayTy()) {
-                    if (notSeen.find((*ii)->getArrayElementType()) != notSeen.end()) {
-                        allSeen = false;
+                if (work.back().second != deps[node].end()) {
+                    // visit the next dependency
+                    T dep = *work.back().second;
+                    work.back().second++;
+                    
+                    typename unordered_map<T, NodeState>::iterator found = states.find(dep);
+                    if (found == states.end()) {
+                        continue;
+                    } else if (!found->second.index) {
+                        found->second.index = found->second.lowlink = nextIndex++;
+                        found->second.onStack = true;
+                        sccStack.push_back(dep);
+                        work.push_back(make_pair(dep, deps[dep].begin()));
+                    } else if (found->second.onStack) {
+                        state.lowlink = min(state.lowlink, found->second.index);
                     }
-                } else if ((*ii)->isStructTy()) {
-                    for (unsigned i = 0; i < (*ii)->getStructNumElements(); i++) {
-                        if (notSeen.find((*ii)->getStructElementType(i)) != notSeen.end()) {
-                            allSeen = false;
-                            break;
+                    continue;
+                }
+                
+                // all dependencies visited; propagate the lowlink upwards
+                work.pop_back();
+                if (!work.empty()) {
+                    NodeState &parent = states[work.back().first];
+                    parent.lowlink = min(parent.lowlink, state.lowlink);
+                }
+                
+                if (state.lowlink == state.index) {
+                    // this node is the root of a component, which is at the top of the stack
+                    list<T> scc;
+                    T member;
+                    do {
+                        member = sccStack.back();
+                        sccStack.pop_back();
+                        states[member].onStack = false;
+                        scc.push_front(member);
+                    } while (member != node);
+                    
+                    // Every component this one depends on has already been placed, so we know if any of them were ignored.
+                    bool ignore = scc.size() > 1;
+                    for (typename list<T>::iterator jj = scc.begin(); jj != scc.end() && !ignore; jj++) {
+                        for (typename list<T>::iterator kk = deps[*jj].begin(); kk != deps[*jj].end(); kk++) {
+                            typename unordered_map<T, NodeState>::iterator found = states.find(*kk);
+                            if (*kk == *jj || (found != states.end() && found->second.ignored)) {
+                                ignore = true;
+                                break;
+                            }
                         }
                     }
-                } else if ((*ii)->isVectorTy()) {
-                    if (notSeen.find((*ii)->getVectorElementType()) != notSeen.end()) {
-                        allSeen = false;
+                    
+                    if (ignore) {
+                        for (typename list<T>::iterator jj = scc.begin(); jj != scc.end(); jj++) {
+                            states[*jj].ignored = true;
+                        }
+                        ignored.push_back(scc);
+                    } else {
+                        order.insert(order.end(), scc.begin(), scc.end());
                     }
                 }
-                
-                if (allSeen) {
-                    changed = true;
-                    types.push_back(*ii);
-                    ii = notSeen.erase(ii);
-                } else {
-                    ii++;
+            }
+        }
+    }
+    
+    void getCorrectDerivedTypeOrder(list<Type*> &types, TypeInfo &info, AnnotatedModule* mod) {
+        list<Type*> nodes;
+        nodes.insert(nodes.end(), info.ptrTypes.begin(), info.ptrTypes.end());
+        nodes.insert(nodes.end(), info.arrayTypes.begin(), info.arrayTypes.end());
+        nodes.insert(nodes.end(), info.structTypes.begin(), info.structTypes.end());
+        nodes.insert(nodes.end(), info.vectorTypes.begin(), info.vectorTypes.end());
+        
+        // a derived type depends on the types it is made from
+        unordered_map<Type*, list<Type*>> deps;
+        for (list<Type*>::iterator ii = nodes.begin(); ii != nodes.end(); ii++) {
+            list<Type*> &typeDeps = deps[*ii];
+            if ((*ii)->isPointerTy()) {
+                typeDeps.push_back((*ii)->getPointerElementType());
+            } else if ((*ii)->isArrayTy()) {
+                typeDeps.push_back((*ii)->getArrayElementType());
+            } else if ((*ii)->isStructTy()) {
+                for (unsigned i = 0; i < (*ii)->getStructNumElements(); i++) {
+                    typeDeps.push_back((*ii)->getStructElementType(i));
                 }
+            } else if ((*ii)->isVectorTy()) {
+                typeDeps.push_back((*ii)->getVectorElementType());
             }
-        } while (changed);
+        }
+        
+        list<list<Type*>> recursive;
+        getDependencyOrder(nodes, deps, types, recursive);
     }
     
-    void getCorrectFunctionOrder(list<AnnotatedFunction*> &funcs, AnnotatedModule* mod) {
-        unordered_map<AnnotatedFunction*,TypeInfo> infos;
+    void getCorrectFunctionOrder(list<AnnotatedFunction*> &funcs, AnnotatedModule* mod, list<list<AnnotatedFunction*>>* recursive) {
+        // a function depends on every function it calls
+        unordered_map<AnnotatedFunction*, list<AnnotatedFunction*>> deps;
         for (list<AnnotatedFunction*>::iterator ii = mod->getFunctions()->begin(); ii != mod->getFunctions()->end(); ii++) {
-            TypeInfo info;
-            getTypeInfo(info, *ii);
-            infos[*ii] = info;
+            list<AnnotatedFunction*> &funcDeps = deps[*ii];
+            unordered_set<Function*>* called = &(*ii)->getTypeInfo()->funcsCalled;
+            for (unordered_set<Function*>::iterator jj = called->begin(); jj != called->end(); jj++) {
+                AnnotatedFunction* func = mod->getFunction(*jj);
+                if (func) {
+                    funcDeps.push_back(func);
+                }
+            }
         }
         
-        unordered_set<AnnotatedFunction*> notSeen(mod->getFunctions()->begin(), mod->getFunctions()->end());
+        list<list<AnnotatedFunction*>> ignored;
+        getDependencyOrder(*mod->getFunctions(), deps, funcs, ignored);
+        if (recursive) {
+            recursive->splice(recursive->end(), ignored);
+        }
+    }
+    
+    /**
+     * A single goal theory to be generated by addGoals.
+     */
+    struct GoalTask {
+        AnnotatedFunction* func;
+        FunctionGoals* goals;
+        /// The goal to generate. If NULL, this generates the goal base theory of func instead.
+        GoalSite* site;
+        bool sharedGoals;
+        
+        /// When generating in parallel, the theory and any warnings found are kept here until it is this task's turn to be written.
+        ostringstream out;
+        list<whyr_warning> warnings;
+        exception_ptr error;
+        bool done = false;
+    };
+    
+    static void addGoalTask(ostream &out, GoalTask* task) {
+        if (!task->site) {
+            addGoalBase(out, task->func, *task->goals);
+        } else if (task->sharedGoals) {
+            addSharedGoal(out, task->func, *task->site);
+        } else {
+            addGoal(out, task->func, task->site->theoryName, task->site->goalExpr, task->site->goalInst);
+        }
+    }
+    
+    /**
+     * Asking an aggregate constant for one of its elements can create that element in the LLVMContext.
+     * This asks for every element addOperand will ask for, so they all exist before goal generation starts.
+     * Constants addOperand writes as variables, such as undef, are given their temporary names here too.
+     */
+    static void prepareConstant(AnnotatedModule* module, Constant* c, unordered_set<Constant*> &seen) {
+        if (!seen.insert(c).second) return;
         
-        // while there's still more nodes in need of calculation; that is, if the state changed since last iteration...
-        bool changed;
-        do {
-            changed = false;
-            
-            for (unordered_set<AnnotatedFunction*>::iterator ii = notSeen.begin(); ii != notSeen.end(); /* ii++ is below */) {
-                
-                unordered_set<Function*>* called = &infos[*ii].funcsCalled;
-                
-                // if all dependancy nodes have been seen, then we are ready to add to the list.
-                // Note that this means nodes with no dependencies automatically pass the test.
-                bool allSeen = true;
-                for (unordered_set<Function*>::iterator jj = called->begin(); jj != called->end(); jj++) {
-                    AnnotatedFunction* func = mod->getFunction(*jj);
-                    if (notSeen.find(func) != notSeen.end()) {
-                        allSeen = false;
-                        break;
-                    }
+        if (isWhy3Variable(c)) {
+            getWhy3VarName(module, c);
+        }
+        
+        if (isa<ConstantDataSequential>(c)) {
+            ConstantDataSequential* cc = cast<ConstantDataSequential>(c);
+            for (unsigned i = 0; i < cc->getNumElements(); i++) {
+                prepareConstant(module, cc->getElementAsConstant(i), seen);
+                cc->getAggregateElement(i);
+            }
+        } else if (isa<ConstantAggregateZero>(c)) {
+            ConstantAggregateZero* cc = cast<ConstantAggregateZero>(c);
+            if (c->getType()->isStructTy()) {
+                for (unsigned i = 0; i < c->getType()->getStructNumElements(); i++) {
+                    prepareConstant(module, cc->getStructElement(i), seen);
                 }
-                
-                if (allSeen) {
-                    changed = true;
-                    funcs.push_back(*ii);
-                    ii = notSeen.erase(ii);
-                } else {
-                    ii++;
+            } else if (c->getType()->isArrayTy() || c->getType()->isVectorTy()) {
+                prepareConstant(module, cc->getSequentialElement(), seen);
+            }
+        } else if (isa<ConstantStruct>(c)) {
+            for (unsigned i = 0; i < c->getType()->getStructNumElements(); i++) {
+                prepareConstant(module, c->getAggregateElement(i), seen);
+            }
+        } else {
+            for (User::op_iterator ii = c->op_begin(); ii != c->op_end(); ii++) {
+                if (isa<Constant>(ii->get()) && !isa<GlobalValue>(ii->get())) {
+                    prepareConstant(module, cast<Constant>(ii->get()), seen);
                 }
             }
-        } while (changed);
+        }
     }
     
-    void addGoals(ostream &out, AnnotatedModule* module) {
-        unsigned asserts = 1;
-        unsigned calls = 1;
+    /**
+     * Does prepareConstant on every constant in an annotation.
+     */
+    static void prepareMetadata(AnnotatedModule* module, Metadata* md, unordered_set<Constant*> &seen, unordered_set<MDNode*> &seenNodes) {
+        if (isa<ConstantAsMetadata>(md)) {
+            prepareConstant(module, cast<ConstantAsMetadata>(md)->getValue(), seen);
+        } else if (isa<MDNode>(md)) {
+            MDNode* node = cast<MDNode>(md);
+            if (!seenNodes.insert(node).second) return;
+            for (unsigned i = 0; i < node->getNumOperands(); i++) {
+                if (node->getOperand(i)) {
+                    prepareMetadata(module, node->getOperand(i).get(), seen, seenNodes);
+                }
+            }
+        }
+    }
+    
+    /**
+     * Goal generation only reads from the module, except for things computed lazily on first use.
+     * This computes all of those ahead of time, in a fixed order, so worker threads never write to shared state
+     * and temporary names come out the same no matter how many threads are used.
+     */
+    static void prepareGoalGeneration(AnnotatedModule* module) {
+        module->getTypeInfo();
+        module->indexFunctions();
+        
+        // struct layouts are cached by the DataLayout the first time they are asked for
+        TypeInfo* info = module->getTypeInfo();
+        for (unordered_set<StructType*>::iterator ii = info->structTypes.begin(); ii != info->structTypes.end(); ii++) {
+            if (!(*ii)->isOpaque()) {
+                module->rawIR()->getDataLayout().getStructLayout(*ii);
+            }
+        }
+        
+        // types and constants are created in the LLVMContext the first time they are asked for
+        LLVMContext &ctx = module->rawIR()->getContext();
+        Type* ptrIntType = IntegerType::get(ctx, module->rawIR()->getDataLayout().getPointerSizeInBits(0)); // TODO: address spaces...
+        unordered_set<Constant*> constants;
+        unordered_set<MDNode*> nodes;
+        for (Module::global_iterator ii = module->rawIR()->global_begin(); ii != module->rawIR()->global_end(); ii++) {
+            if (ii->hasInitializer()) {
+                prepareConstant(module, ii->getInitializer(), constants);
+            }
+        }
         
         for (Module::iterator ii = module->rawIR()->begin(); ii != module->rawIR()->end(); ii++) {
             AnnotatedFunction* func = module->getFunction(&*ii);
-            if (func->getEnsuresClause()) {
-                addGoal(out, func, "Goal_" + getWhy3SafeName(string(ii->getName().data())) + "_ensures", func->getEnsuresClause(), NULL);
+            if (!func) continue; // left out by the function filters
+            func->getTypeInfo();
+            func->indexAnnotatedInstructions();
+            
+            SmallVector<pair<unsigned, MDNode*>, 4> funcMetadata;
+            ii->getAllMetadata(funcMetadata);
+            for (SmallVector<pair<unsigned, MDNode*>, 4>::iterator jj = funcMetadata.begin(); jj != funcMetadata.end(); jj++) {
+                prepareMetadata(module, jj->second, constants, nodes);
             }
             
+            for (Function::arg_iterator jj = ii->arg_begin(); jj != ii->arg_end(); jj++) {
+                getWhy3VarName(module, &*jj);
+            }
             for (Function::iterator jj = ii->begin(); jj != ii->end(); jj++) {
+                getWhy3BlockName(func, &*jj);
                 for (BasicBlock::iterator kk = jj->begin(); kk != jj->end(); kk++) {
-                    AnnotatedInstruction* inst = func->getAnnotatedInstruction(&*kk);
-                    if (inst && inst->getAssertClause()) {
-                        string goalName = "Goal_" + getWhy3SafeName(string(ii->getName().data())) + "_assert_";
-                        if (inst->getAssertClause()->getSource() && inst->getAssertClause()->getSource()->label) {
-                            goalName += inst->getAssertClause()->getSource()->label;
+                    if (!kk->getType()->isVoidTy()) {
+                        getWhy3VarName(module, &*kk);
+                    }
+                    if ((isa<PtrToIntInst>(&*kk) || isa<IntToPtrInst>(&*kk)) && kk->getType()->isVectorTy()) {
+                        VectorType::get(ptrIntType, kk->getType()->getVectorNumElements());
+                    }
+                    for (User::op_iterator ll = kk->op_begin(); ll != kk->op_end(); ll++) {
+                        if (isa<Constant>(ll->get()) && !isa<GlobalValue>(ll->get())) {
+                            prepareConstant(module, cast<Constant>(ll->get()), constants);
+                        } else if (!isa<Constant>(ll->get()) && !isa<BasicBlock>(ll->get())) {
+                            // such as metadata passed to an intrinsic
+                            getWhy3VarName(module, ll->get());
                         }
-                        goalName += "_" + to_string(asserts);
-                        addGoal(out, func, goalName, inst->getAssertClause(), &*kk);
-                        asserts++;
                     }
-                    
-                    if (isa<CallInst>(&*kk)) {
-                        CallInst* callInst = cast<CallInst>(&*kk);
-                        Function* calledFuncRaw = callInst->getCalledFunction();
-                        AnnotatedFunction* calledFunc = func->getModule()->getFunction(calledFuncRaw);
-                        
-                        if (calledFunc->getRequiresClause()) {
-                            string goalName = "Goal_" + getWhy3SafeName(string(ii->getName().data())) + "_call_" + getWhy3SafeName(string(calledFuncRaw->getName().data())) + "_" + to_string(calls);
-                            addGoal(out, func, goalName, calledFunc->getRequiresClause(), &*kk);
-                            calls++;
+                    SmallVector<pair<unsigned, MDNode*>, 4> instMetadata;
+                    kk->getAllMetadata(instMetadata);
+                    for (SmallVector<pair<unsigned, MDNode*>, 4>::iterator ll = instMetadata.begin(); ll != instMetadata.end(); ll++) {
+                        prepareMetadata(module, ll->second, constants, nodes);
+                    }
+                    // calls get their own theory names
+                    if (CallInst* call = dyn_cast<CallInst>(&*kk)) {
+                        if (call->getCalledFunction()) {
+                            getTempName(module, call);
                         }
                     }
                 }
             }
+            func->getLayout();
+        }
+        
+        // every temporary name the goals need has been given out, so workers can look them up without locking
+        module->getNameMangler()->seal();
+    }
+    
+    void addGoals(ostream &out, AnnotatedModule* module) {
+        unsigned asserts = 1;
+        unsigned calls = 1;
+        
+        bool sharedGoals = module->getSettings() && module->getSettings()->sharedGoals;
+        unsigned jobs = module->getSettings() ? module->getSettings()->jobs : 1;
+        
+        // find every goal theory we need to generate, in the order they are output
+        list<FunctionGoals> allGoals;
+        vector<GoalTask*> tasks;
+        for (Module::iterator ii = module->rawIR()->begin(); ii != module->rawIR()->end(); ii++) {
+            AnnotatedFunction* func = module->getFunction(&*ii);
+            // left out by the function filters, only there for its contract, or only kept for its blocks
+            if (!func || ii->isDeclaration() || !module->isSelected(&*ii)) continue;
+            
+            allGoals.push_back(FunctionGoals());
+            FunctionGoals* goals = &allGoals.back();
+            getFunctionGoals(*goals, func, asserts, calls);
+            
+            // the results of unchanged functions come from the manifest instead
+            if (module->getSettings() && module->getSettings()->manifest && !goals->sites.empty() && module->getSettings()->manifest->checkFunction(func, *goals)) {
+                continue;
+            }
+            
+            // in shared goal mode, emit the blocks once, and have each goal clone them
+            if (sharedGoals && !goals->sites.empty()) {
+                GoalTask* task = new GoalTask();
+                task->func = func;
+                task->goals = goals;
+                task->site = NULL;
+                task->sharedGoals = sharedGoals;
+                tasks.push_back(task);
+            }
+            for (list<GoalSite>::iterator jj = goals->sites.begin(); jj != goals->sites.end(); jj++) {
+                GoalTask* task = new GoalTask();
+                task->func = func;
+                task->goals = goals;
+                task->site = &*jj;
+                task->sharedGoals = sharedGoals;
+                tasks.push_back(task);
+            }
+        }
+        
+        prepareGoalGeneration(module);
+        
+        if (jobs <= 1 || tasks.size() <= 1) {
+            vector<GoalTask*>::iterator ii;
+            try {
+                for (ii = tasks.begin(); ii != tasks.end(); ii++) {
+                    addGoalTask(out, *ii);
+                    delete *ii;
+                }
+            } catch (...) {
+                // the task that threw has not been freed yet
+                for (; ii != tasks.end(); ii++) {
+                    delete *ii;
+                }
+                throw;
+            }
+            return;
+        }
+        
+        // Each worker takes the next task not yet started, and generates it into the task's own buffer.
+        mutex doneMutex;
+        condition_variable doneCond;
+        WorkerPool workers(jobs, tasks.size(), [&](size_t j) {
+            GoalTask* task = tasks[j];
+            goal_warnings = &task->warnings;
+            try {
+                addGoalTask(task->out, task);
+            } catch (...) {
+                task->error = current_exception();
+            }
+            goal_warnings = NULL;
+            
+            {
+                lock_guard<mutex> lock(doneMutex);
+                task->done = true;
+            }
+            doneCond.notify_all();
+        });
+        
+        // Meanwhile, write out each theory in order as soon as it is done, so finished theories don't pile up in memory.
+        exception_ptr error;
+        size_t i;
+        for (i = 0; i < tasks.size(); i++) {
+            GoalTask* task = tasks[i];
+            {
+                unique_lock<mutex> lock(doneMutex);
+                doneCond.wait(lock, [task]() { return task->done; });
+            }
+            
+            if (task->error) {
+                // stop handing out tasks, and report the error once the workers finish
+                error = task->error;
+                workers.stop();
+                break;
+            }
+            
+            out << task->out.str();
+            if (module->getSettings()) {
+                module->getSettings()->warnings.splice(module->getSettings()->warnings.end(), task->warnings);
+            }
+            delete task;
+        }
+        
+        workers.join();
+        
+        if (error) {
+            for (; i < tasks.size(); i++) {
+                delete tasks[i];
+            }
+            rethrow_exception(error);
         }
     }
     
@@ -2862,7 +3399,8 @@ end
         addGlobals(out, module);
         
         list<AnnotatedFunction*> funcs;
-        getCorrectFunctionOrder(funcs, module);
+        list<list<AnnotatedFunction*>> recursive;
+        getCorrectFunctionOrder(funcs, module, &recursive);
         
         for (list<AnnotatedFunction*>::iterator ii = funcs.begin(); ii != funcs.end(); ii++) {
             addFunction(out, *ii);
@@ -2870,11 +3408,11 @@ end
         
         // TODO: recursive or mutually recursive functions are currently left out, because Why3 does not allow for out-of-order theory definitions.
         // In the future, we will have to add a handler for recursion (we can forward declare once inside a theory), and inline all mutually recursive functions.
-        for (list<AnnotatedFunction*>::iterator ii = module->getFunctions()->begin(); ii != module->getFunctions()->end(); ii++) {
-            if (find(funcs.begin(), funcs.end(), *ii) == funcs.end()) {
-                // if the function was left out, warn the user
-                if (module->getSettings()) {
-                    module->getSettings()->warnings.push_back(whyr_warning("Function '" + string((*ii)->rawIR()->getName().data()) + "' is recursive or mutually recursive; function ignored"));
+        if (module->getSettings()) {
+            for (list<list<AnnotatedFunction*>>::iterator ii = recursive.begin(); ii != recursive.end(); ii++) {
+                for (list<AnnotatedFunction*>::iterator jj = ii->begin(); jj != ii->end(); jj++) {
+                    // the function was left out, so warn the user
+                    module->getSettings()->warnings.push_back(whyr_warning("Function '" + string((*jj)->rawIR()->getName().data()) + "' is recursive or mutually recursive; function ignored"));
                 }
             }
         }
@@ -7,11 +7,22 @@
 
 #include <whyr/exec_why3.hpp>
 #include <whyr/exception.hpp>
+#include <whyr/proof_cache.hpp>
+#include <whyr/workers.hpp>
 
 #include <iostream>
 #include <sstream>
 #include <string>
 #include <list>
+#include <vector>
+#include <algorithm>
+#include <unordered_set>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <exception>
 
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -19,21 +30,58 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <sys/resource.h>
 
 namespace whyr {
     using namespace std;
     using namespace llvm;
     
-    void execWhy3(string &in, ostream &out, bool checkOnly, const string &prover) {
-        pid_t pid;
-        int rv;
+    /// How many seconds past the time limit Why3 may go without finishing a goal before it is killed.
+    static const unsigned WATCHDOG_GRACE = 10;
+    /// Before its first goal, Why3 also gets a second for every this many bytes of input, to parse and type check it.
+    static const size_t WATCHDOG_PARSE_RATE = 100000;
+    
+    Why3Process::Why3Process(bool checkOnly, const string &prover, const Why3Limits &limits) : limits{limits} {
         int inpipe[2];
         int outpipe[2];
         
-        if (pipe(inpipe) || pipe(outpipe)) {
+        // Build the command line now; the child may not allocate memory if other threads are running.
+        vector<string> args;
+        args.push_back("why3");
+        args.push_back("prove");
+        if (checkOnly) {
+            args.push_back("-F"); args.push_back("why");
+            args.push_back("--type-only");
+        } else {
+            args.push_back("-P"); args.push_back(prover);
+            args.push_back("-F"); args.push_back("why");
+            args.push_back("-a"); args.push_back("inline_all");
+            if (limits.time) {
+                args.push_back("-t"); args.push_back(to_string(limits.time));
+            }
+            if (limits.memory) {
+                args.push_back("-m"); args.push_back(to_string(limits.memory));
+            }
+        }
+        args.push_back("-");
+        vector<char*> argv;
+        for (vector<string>::iterator ii = args.begin(); ii != args.end(); ii++) {
+            argv.push_back(&(*ii)[0]);
+        }
+        argv.push_back(NULL);
+        
+        // Close-on-exec, so other Why3 processes started at the same time don't hold on to this one's pipes.
+        // dup2 clears the flag on the copies the child actually uses.
+        if (pipe2(inpipe, O_CLOEXEC) || pipe2(outpipe, O_CLOEXEC)) {
             throw whyr_exception("when executing why3: pipe() failed");
         }
         
+        // If why3 exits before reading all its input, we want a failed write, not to be killed.
+        signal(SIGPIPE, SIG_IGN);
+        
         pid = fork();
         if (pid == -1) {
             throw whyr_exception("when executing why3: fork() failed");
@@ -41,28 +89,28 @@ namespace whyr {
         
         if (pid) {
             // parent
+            // Why3 and its provers get their own process group, so the watchdog can kill them all at once.
+            // Both sides set it, so it is in place no matter which runs first.
+            setpgid(pid, pid);
+            
             close(inpipe[0]);
             close(outpipe[1]);
-            // prints here give input to child via inpipe[1], the writey end of the in-pipe
-            write(inpipe[1], in.c_str(), in.size());
-            // done writing input, wait for end of process
-            close(inpipe[1]);
-            waitpid(pid, &rv, 0);
-            // reads here are output of child via outpipe[0], the ready end of the out-pipe
-            char buf[128];
-            ssize_t n;
-            do {
-                n = read(outpipe[0], buf, 127);
-                if (n == -1) {
-                    throw whyr_exception("when executing why3: read() failed");
-                }
-                buf[n] = '\0';
-                out << buf;
-            } while (n > 0);
-            
-            close(outpipe[0]);
+            // prints here give input to child via inpipe[1], the writey end of the in-pipe,
+            // while output of child is read from outpipe[0], the ready end of the out-pipe
+            pipes = new DuplexStreamBuf(inpipe[1], outpipe[0], &earlyOutput);
+            input = new ostream(pipes);
         } else {
             // child
+            setpgid(0, 0);
+            
+            // rlimits are inherited by the provers why3 runs, so each of them is held to these as well.
+            // There is no CPU limit, since that would count every goal Why3 proves; Why3 limits the time of each goal itself.
+            if (limits.memory) {
+                rlimit mem;
+                mem.rlim_cur = mem.rlim_max = (rlim_t) limits.memory * 1024 * 1024;
+                setrlimit(RLIMIT_AS, &mem);
+            }
+            
             dup2(inpipe[0], 0); // stdin = ready end of in-pipe
             dup2(outpipe[1], 1); // stdout + stderr = writey end of out-pipe
             dup2(outpipe[1], 2);
@@ -70,135 +118,960 @@ namespace whyr {
             close(inpipe[1]);
             close(outpipe[0]);
             
-            if (checkOnly) {
-                if (execlp("why3", "why3", "prove", "-F", "why", "--type-only", "-", NULL) == -1) {
-                    throw whyr_exception("when executing why3: execlp() failed");
-                }
-            } else {
-                if (execlp("why3", "why3", "prove", "-P", prover.c_str(), "-F", "why", "-a", "inline_all", "-", NULL) == -1) {
-                    throw whyr_exception("when executing why3: execlp() failed");
-                }
+            execvp(argv[0], argv.data());
+            // only get here if exec failed
+            _exit(127);
+        }
+    }
+    
+    Why3Process::~Why3Process() {
+        if (pipes) {
+            ostringstream discarded;
+            try {
+                finish(discarded);
+            } catch (whyr_exception &ex) {
+                // nobody wanted the output, so nobody wants to know it was bad either
             }
         }
     }
     
-    Why3Output::Why3Output(const char* str) {
-        while (strncmp(str, "File \"", 6) == 0) {
-            // grab line info in case it is an error
-            size_t n;
-            char* lineStr;
-            
-            n = strcspn(str, ",");
-            str += n + 7;
+    ostream& Why3Process::getInput() {
+        return *input;
+    }
+    
+    void Why3Process::setOutput(ostream &out) {
+        out << earlyOutput.str();
+        earlyOutput.str("");
+        pipes->setSink(out.rdbuf());
+    }
+    
+    void Why3Process::finish(ostream &out) {
+        // the output is also parsed, to tell a failed Why3 from one that found an error in its input
+        Why3OutputParser check([](const Why3GoalRef &goal) {});
+        TeeStreamBuf tee(out.rdbuf(), &check);
+        ostream teeOut(&tee);
+        setOutput(teeOut);
+        
+        // done writing input
+        input->flush();
+        pipes->close();
+        
+        // Read until why3 closes its output, then reap it.
+        // Waiting first could deadlock if why3 filled the out-pipe before exiting.
+        // Why3 prints each goal as it finishes, so with a time limit, going too long without output means a goal is stuck.
+        int goalTimeout = -1, firstTimeout = -1;
+        if (limits.time) {
+            goalTimeout = (limits.time + WATCHDOG_GRACE) * 1000;
+            firstTimeout = goalTimeout + pipes->getBytesWritten() * 1000 / WATCHDOG_PARSE_RATE;
+        }
+        bool readOk = pipes->readAll(goalTimeout, firstTimeout);
+        if (!readOk && pipes->timedOut()) {
+            kill(-pid, SIGKILL);
+            killed = true;
+            readOk = pipes->readAll();
+        }
+        delete input;
+        input = NULL;
+        delete pipes;
+        pipes = NULL;
+        
+        int rv;
+        bool wasCancelled;
+        {
+            lock_guard<mutex> guard(lock);
+            waitpid(pid, &rv, 0);
+            exited = true;
+            wasCancelled = cancelled;
+        }
+        teeOut.flush();
+        check.finish();
+        
+        if (!readOk) {
+            throw whyr_exception("when executing why3: read() failed");
+        }
+        if (WIFSIGNALED(rv)) {
+            if (WTERMSIG(rv) == SIGXCPU) {
+                killed = true;
+            } else if (!(WTERMSIG(rv) == SIGKILL && (killed || wasCancelled))) {
+                throw whyr_exception(("when executing why3: why3 was killed by signal " + to_string(WTERMSIG(rv))).c_str());
+            }
+        } else if (WIFEXITED(rv) && WEXITSTATUS(rv) == 127) {
+            throw whyr_exception("when executing why3: could not run why3");
+        } else if (WIFEXITED(rv) && WEXITSTATUS(rv) != 0 && !check.error && !killed && !wasCancelled) {
+            // Why3 exits with an error when its input has one, but then it says where
+            throw whyr_exception(("when executing why3: why3 exited with status " + to_string(WEXITSTATUS(rv))).c_str());
+        }
+    }
+    
+    bool Why3Process::hitTimeLimit() {
+        return killed;
+    }
+    
+    void Why3Process::cancel() {
+        lock_guard<mutex> guard(lock);
+        if (!exited) {
+            kill(-pid, SIGKILL);
+            cancelled = true;
+        }
+    }
+    
+    void execWhy3(string &in, ostream &out, bool checkOnly, const string &prover, const Why3Limits &limits) {
+        Why3Process why3(checkOnly, prover, limits);
+        why3.getInput() << in;
+        why3.finish(out);
+    }
+    
+    /**
+     * Returns the name of the theory a line of Why3 code uses or clones, or an empty string if it does neither.
+     */
+    static string getUsedTheoryName(const string &line) {
+        size_t first = line.find_first_not_of(' ');
+        if (first == string::npos || (line.compare(first, 4, "use ") != 0 && line.compare(first, 6, "clone ") != 0)) {
+            return "";
+        }
+        
+        // use [import|export] <theory>, or clone [import|export] <theory> [as <name>] [with ...]
+        istringstream words(line);
+        string word, name;
+        words >> word >> name;
+        if (name == "import" || name == "export") {
+            words >> name;
+        }
+        return name;
+    }
+    
+    Why3TaskList::Why3TaskList(const string &in) {
+        // Generated theories start with 'theory' and end with 'end' at the start of a line.
+        // Anything outside of a theory, like the header comment, is kept with the theory after it.
+        unordered_map<string, size_t> indices;
+        string pending;
+        Theory* current = NULL;
+        
+        size_t pos = 0;
+        while (pos < in.size()) {
+            size_t eol = in.find('\n', pos);
+            size_t next = (eol == string::npos) ? in.size() : eol + 1;
+            string line = in.substr(pos, next - pos);
+            pos = next;
             
-            n = strcspn(str, ",");
-            lineStr = strndup(str, n);
-            line = strtoul(lineStr, NULL, 0);
-            free(lineStr);
-            str += n + 14;
+            if (!current) {
+                if (line.compare(0, 7, "theory ") == 0) {
+                    theories.push_back(Theory());
+                    current = &theories.back();
+                    current->name = line.substr(7, line.find_first_of(" \n", 7) - 7);
+                    indices[current->name] = theories.size() - 1;
+                    current->text = pending;
+                    current->withoutGoals = pending;
+                    pending.clear();
+                } else {
+                    pending += line;
+                    continue;
+                }
+            }
             
-            n = strcspn(str, "-");
-            lineStr = strndup(str, n);
-            colBegin = strtoul(lineStr, NULL, 0);
-            free(lineStr);
-            str += n + 1;
+            current->text += line;
+            if (line.compare(0, 9, "    goal ") == 0) {
+                current->hasGoals = true;
+                current->goals.push_back(line.substr(9, line.find_first_of(": \n", 9) - 9));
+            } else {
+                current->withoutGoals += line;
+            }
             
-            n = strcspn(str, ":");
-            lineStr = strndup(str, n);
-            colEnd = strtoul(lineStr, NULL, 0);
-            free(lineStr);
+            // remember every theory this one depends on; theories of the standard library are not in the input
+            string used = getUsedTheoryName(line);
+            if (!used.empty()) {
+                unordered_map<string, size_t>::iterator index = indices.find(used);
+                if (index != indices.end()) {
+                    current->uses.push_back(index->second);
+                }
+            }
             
-            // either an error or a warning.
-            while (*str != '\n' && *str != '\0') {
-                str++;
+            if (line.compare(0, 3, "end") == 0 && (line.size() == 3 || line[3] == '\n')) {
+                current = NULL;
             }
-            if (*str == '\0') {
-                error = true;
-                return;
+        }
+        
+        for (size_t i = 0; i < theories.size(); i++) {
+            if (theories[i].hasGoals) {
+                goalTheories.push_back(i);
             }
-            str++;
-            if (strncmp(str, "warning:", 8) == 0) {
-                // warning; ignore it
-                while (*str != '\n' && *str != '\0') {
-                    str++;
-                }
-                if (*str == '\0') {
-                    error = true;
-                    return;
+        }
+    }
+    
+    size_t Why3TaskList::size() {
+        return goalTheories.size();
+    }
+    
+    void Why3TaskList::markClosure(size_t task, vector<char> &needed) {
+        vector<size_t> pending(1, goalTheories[task]);
+        while (!pending.empty()) {
+            size_t i = pending.back();
+            pending.pop_back();
+            if (needed[i]) continue;
+            needed[i] = true;
+            pending.insert(pending.end(), theories[i].uses.begin(), theories[i].uses.end());
+        }
+    }
+    
+    string Why3TaskList::getTask(size_t task) {
+        return getClosure(task);
+    }
+    
+    string Why3TaskList::getBatch(const vector<size_t> &tasks) {
+        // every theory the goals of some task in the batch reach is written once, in the order of the input,
+        // with goals if it belongs to the batch, and without otherwise
+        vector<char> needed(theories.size());
+        vector<char> members(theories.size());
+        for (vector<size_t>::const_iterator ii = tasks.begin(); ii != tasks.end(); ii++) {
+            markClosure(*ii, needed);
+            members[goalTheories[*ii]] = true;
+        }
+        
+        string result;
+        for (size_t i = 0; i < theories.size(); i++) {
+            if (members[i]) {
+                result += theories[i].text;
+            } else if (needed[i]) {
+                result += theories[i].withoutGoals;
+            }
+        }
+        return result;
+    }
+    
+    string Why3TaskList::getClosure(size_t task) {
+        // mark every theory the goal theory reaches, then write them out in the order of the input
+        vector<char> needed(theories.size());
+        markClosure(task, needed);
+        
+        string result;
+        for (size_t i = 0; i < goalTheories[task]; i++) {
+            if (needed[i]) {
+                result += theories[i].withoutGoals;
+            }
+        }
+        return result + theories[goalTheories[task]].text;
+    }
+    
+    const string& Why3TaskList::getTheoryName(size_t task) {
+        return theories[goalTheories[task]].name;
+    }
+    
+    const string& Why3TaskList::getTheoryText(size_t task) {
+        return theories[goalTheories[task]].text;
+    }
+    
+    const vector<string>& Why3TaskList::getGoalNames(size_t task) {
+        return theories[goalTheories[task]].goals;
+    }
+    
+    void splitWhy3Tasks(const string &in, list<string> &tasks) {
+        Why3TaskList taskList(in);
+        for (size_t i = 0; i < taskList.size(); i++) {
+            tasks.push_back(taskList.getTask(i));
+        }
+    }
+    
+    /**
+     * Returns true if out has a result for every goal of a task.
+     */
+    static bool hasAllGoals(Why3TaskList &taskList, size_t task, Why3Output &out) {
+        unordered_set<string> reported;
+        for (list<Why3Goal>::iterator ii = out.goals.begin(); ii != out.goals.end(); ii++) {
+            reported.insert(ii->goal);
+        }
+        
+        const vector<string> &goals = taskList.getGoalNames(task);
+        for (vector<string>::const_iterator ii = goals.begin(); ii != goals.end(); ii++) {
+            if (!reported.count(*ii)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    /**
+     * Adds a timed out goal to out for every goal of a task that out has no result for.
+     */
+    static void addTimedOutGoals(Why3TaskList &taskList, size_t task, Why3Output &out, const Why3Limits &limits) {
+        unordered_set<string> reported;
+        for (list<Why3Goal>::iterator ii = out.goals.begin(); ii != out.goals.end(); ii++) {
+            reported.insert(ii->goal);
+        }
+        
+        const vector<string> &goals = taskList.getGoalNames(task);
+        for (vector<string>::const_iterator ii = goals.begin(); ii != goals.end(); ii++) {
+            if (!reported.count(*ii)) {
+                Why3Goal goal;
+                goal.theory = strdup(taskList.getTheoryName(task).c_str());
+                goal.goal = strdup(ii->c_str());
+                goal.status = Why3Goal::STATUS_TIMEOUT;
+                goal.time = limits.time;
+                out.goals.push_back(goal);
+            }
+        }
+    }
+    
+    /// How long, in milliseconds, the prover that last won a task gets to prove it alone before the rest of a portfolio joins in.
+    static const unsigned PORTFOLIO_HEAD_START = 1000;
+    
+    /**
+     * Returns how good a result a status is, so the best result of a portfolio can be kept. Proofs and disproofs are the best.
+     */
+    static int getStatusRank(Why3Goal::Why3GoalStatus status) {
+        switch (status) {
+            case Why3Goal::STATUS_VALID:
+            case Why3Goal::STATUS_FAIL: {
+                return 3;
+            }
+            case Why3Goal::STATUS_UNKNOWN: {
+                return 2;
+            }
+            case Why3Goal::STATUS_TIMEOUT: {
+                return 1;
+            }
+            default: {
+                return 0;
+            }
+        }
+    }
+    
+    Why3PortfolioResults::Why3PortfolioResults(const vector<pair<string, string> > &goals) : best(goals.size()) {
+        for (size_t i = 0; i < goals.size(); i++) {
+            best[i].theory = goals[i].first;
+            best[i].goal = goals[i].second;
+            indices[goals[i].first + " " + goals[i].second] = i;
+        }
+    }
+    
+    void Why3PortfolioResults::add(const Why3GoalRef &goal, const string &prover) {
+        unordered_map<string, size_t>::iterator index = indices.find(goal.theory.str() + " " + goal.goal.str());
+        if (index == indices.end()) return;
+        Entry &entry = best[index->second];
+        if (entry.found && getStatusRank(goal.status) <= getStatusRank(entry.result.status)) return;
+        
+        if (getStatusRank(goal.status) == 3) {
+            definite++;
+        }
+        entry.found = true;
+        entry.result.status = goal.status;
+        entry.result.time = goal.time;
+        entry.result.steps = goal.steps;
+        entry.result.prover = prover;
+    }
+    
+    bool Why3PortfolioResults::isDecided() {
+        return definite == best.size();
+    }
+    
+    bool Why3PortfolioResults::write(ostream &out, unordered_map<string, string> &winners) {
+        bool complete = true;
+        for (vector<Entry>::iterator ii = best.begin(); ii != best.end(); ii++) {
+            if (!ii->found) {
+                complete = false;
+                continue;
+            }
+            out << "portfolio " << ii->theory << " " << ii->goal << " : ";
+            writeWhy3GoalResult(out, ii->result);
+            out << endl;
+            winners[ii->goal] = ii->result.prover;
+        }
+        return complete;
+    }
+    
+    /**
+     * Proves a batch with each of the provers at once, and returns raw output with the best result any prover gave for each goal.
+     * goals is the theory and name of every goal in the batch, in order.
+     * The first prover in the list starts first; if there is more than one, it has PORTFOLIO_HEAD_START to finish alone.
+     * The provers are stopped once every goal is proven or disproven, or all of them finish.
+     * winners is set to the prover that gave each goal's result, by goal name, if there is more than one prover.
+     * timedOut is set if some goal has no result, and the watchdog stopped a prover.
+     */
+    static string raceWhy3Provers(const string &batch, const vector<pair<string, string> > &goals, const vector<string> &provers, const Why3Limits &limits, unordered_map<string, string> &winners, bool &timedOut) {
+        if (provers.size() == 1) {
+            ostringstream result;
+            Why3Process why3(false, provers[0], limits);
+            why3.getInput() << batch;
+            why3.finish(result);
+            timedOut = why3.hitTimeLimit();
+            return result.str();
+        }
+        
+        mutex raceMutex;
+        condition_variable raceCond;
+        bool stop = false;
+        vector<Why3Process*> processes(provers.size(), NULL);
+        vector<string> results(provers.size());
+        vector<exception_ptr> errors(provers.size());
+        vector<char> done(provers.size());
+        vector<char> timedOuts(provers.size());
+        
+        Why3PortfolioResults best(goals);
+        
+        auto run = [&](size_t i) {
+            try {
+                Why3Process why3(false, provers[i], limits);
+                {
+                    lock_guard<mutex> guard(raceMutex);
+                    if (stop) {
+                        why3.cancel();
+                    }
+                    processes[i] = &why3;
                 }
-                str++;
-            } else {
-                // error
-                error = true;
+                why3.getInput() << batch;
                 
-                n = strcspn(str, "\n");
-                message = strndup(str, n);
-                return;
+                // keep each goal's result as soon as it arrives, if it is better than what the other provers gave
+                Why3OutputParser parser([&](const Why3GoalRef &goal) {
+                    lock_guard<mutex> guard(raceMutex);
+                    best.add(goal, provers[i]);
+                    if (best.isDecided()) {
+                        raceCond.notify_all();
+                    }
+                });
+                ostringstream result;
+                TeeStreamBuf tee(result.rdbuf(), &parser);
+                ostream out(&tee);
+                why3.finish(out);
+                out.flush();
+                parser.finish();
+                
+                lock_guard<mutex> guard(raceMutex);
+                processes[i] = NULL;
+                results[i] = result.str();
+                timedOuts[i] = why3.hitTimeLimit();
+                done[i] = true;
+            } catch (...) {
+                lock_guard<mutex> guard(raceMutex);
+                processes[i] = NULL;
+                errors[i] = current_exception();
+                done[i] = true;
+            }
+            raceCond.notify_all();
+        };
+        
+        auto allDone = [&]() -> bool {
+            if (best.isDecided()) return true;
+            for (size_t i = 0; i < provers.size(); i++) {
+                if (!done[i]) return false;
+            }
+            return true;
+        };
+        
+        vector<thread> racers;
+        racers.push_back(thread(run, 0));
+        
+        unique_lock<mutex> lock(raceMutex);
+        raceCond.wait_for(lock, chrono::milliseconds(PORTFOLIO_HEAD_START), [&]() { return done[0] || best.isDecided(); });
+        if (!best.isDecided()) {
+            lock.unlock();
+            for (size_t i = 1; i < provers.size(); i++) {
+                racers.push_back(thread(run, i));
             }
+            lock.lock();
+            raceCond.wait(lock, allDone);
         }
         
-        // no error
-        error = false;
+        // stop everyone still running, including provers not started yet
+        stop = true;
+        for (size_t i = 0; i < provers.size(); i++) {
+            if (processes[i]) {
+                processes[i]->cancel();
+            }
+        }
+        lock.unlock();
+        for (vector<thread>::iterator ii = racers.begin(); ii != racers.end(); ii++) {
+            ii->join();
+        }
         
-        while (*str != '\0') {
-            Why3Goal goal;
-            size_t n;
-            
-            n = strcspn(str, " ");
-            str += n + 1;
-            
-            n = strcspn(str, " ");
-            goal.theory = strndup(str, n);
-            str += n + 1;
-            
-            n = strcspn(str, " ");
-            goal.goal = strndup(str, n);
-            str += n + 3;
-            
-            n = strcspn(str, " ");
-            if (strncmp(str, "Valid", n) == 0) {
-                goal.status = Why3Goal::STATUS_VALID;
-            } else if (strncmp(str, "Unknown", n) == 0) {
-                goal.status = Why3Goal::STATUS_UNKNOWN;
-            } else if (strncmp(str, "Timeout", n) == 0) {
-                goal.status = Why3Goal::STATUS_TIMEOUT;
-            } else if (strncmp(str, "Failure", n) == 0) {
-                goal.status = Why3Goal::STATUS_FAIL;
-            } else if (strncmp(str, "HighFailure", n) == 0) {
-                // if we had a high failure, the rest of the output is essentially unparsable. Don't even try.
-                goal.status = Why3Goal::STATUS_FAIL;
-                goals.push_back(goal);
-                return;
-            }
-            str += n + 2;
-            
-            n = strcspn(str, ",)");
-            char* timeString = strndup(str, n);
-            goal.time = strtod(timeString, NULL);
-            free(timeString);
-            str += n;
-            
-            if (*str == ',') {
-                // we have steps info
-                str++;
-                n = strcspn(str, ")");
-                char* stepsString = strndup(str, n);
-                goal.steps = strtoul(stepsString, NULL, 0);
-                free(stepsString);
+        for (size_t i = 0; i < provers.size(); i++) {
+            if (errors[i]) {
+                rethrow_exception(errors[i]);
             }
+        }
+        
+        // write the best results the way Why3 would have
+        ostringstream merged;
+        bool missing = !best.write(merged, winners);
+        if (merged.str().empty()) {
+            // nobody proved anything, such as if Why3 found an error in the input; report what the first prover said
+            timedOut = timedOuts[0];
+            return results[0];
+        }
+        
+        timedOut = false;
+        for (size_t i = 0; i < provers.size(); i++) {
+            if (timedOuts[i]) {
+                timedOut = missing;
+            }
+        }
+        return merged.str();
+    }
+    
+    void proveWhy3Tasks(const string &in, Why3Output &out, ostream &raw, unsigned jobs, const string &prover, const Why3Limits &limits, Why3ProofCache* cache, const string &module) {
+        vector<string> provers(1, prover);
+        proveWhy3Tasks(in, out, raw, jobs, provers, limits, cache, module);
+    }
+    
+    /// How long, in seconds, a batch of tasks is expected to take at most. Tasks expected to take longer than this are proven alone.
+    static const double BATCH_TARGET_TIME = 2.0;
+    /// The most tasks ever put in one batch, so a batch stopped by the watchdog loses little.
+    static const size_t MAX_BATCH_SIZE = 32;
+    
+    /// The most bytes of Why3's output besides goal results kept for each task, to show when something goes wrong.
+    static const size_t TASK_LOG_LIMIT = 4096;
+    
+    /**
+     * Splits the raw Why3 output of a batch into the output of each of its tasks, by the theory each line names.
+     * results gets the output of each task, in the order of the batch.
+     * Lines naming no theory of the batch, such as errors, go to the first task of the batch.
+     */
+    static void splitBatchOutput(const string &raw, Why3TaskList &taskList, const vector<size_t> &batch, vector<string> &results) {
+        unordered_map<string, size_t> owners;
+        for (size_t i = 0; i < batch.size(); i++) {
+            owners[taskList.getTheoryName(batch[i])] = i;
+        }
+        
+        size_t pos = 0;
+        while (pos < raw.size()) {
+            size_t eol = raw.find('\n', pos);
+            size_t next = (eol == string::npos) ? raw.size() : eol + 1;
+            string line = raw.substr(pos, next - pos);
+            pos = next;
             
-            goals.push_back(goal);
+            // <file> <theory> <goal> : <result>
+            istringstream fields(line);
+            string file, theory;
+            fields >> file >> theory;
+            unordered_map<string, size_t>::iterator owner = owners.find(theory);
+            results[owner == owners.end() ? 0 : owner->second] += line;
+        }
+    }
+    
+    /**
+     * Parses the raw Why3 output of a task into out, and keeps up to TASK_LOG_LIMIT bytes of the lines that are not goal results in log.
+     */
+    static void parseTaskOutput(const string &raw, Why3Output &out, string &log) {
+        Why3OutputParser parser([&out](const Why3GoalRef &goal) {
+            out.addGoal(goal);
+        }, TASK_LOG_LIMIT);
+        parser.feed(raw.data(), raw.size());
+        parser.finish();
+        out.addError(parser);
+        log = parser.otherLines;
+    }
+    
+    void proveWhy3Tasks(const string &in, Why3Output &out, ostream &raw, unsigned jobs, const vector<string> &provers, const Why3Limits &limits, Why3ProofCache* cache, const string &module) {
+        Why3TaskList taskList(in);
+        size_t tasks = taskList.size();
+        // only the goals of each task are kept, and a little of the rest of its output
+        vector<Why3Output> results(tasks);
+        vector<string> logs(tasks);
+        // the prover that gave each goal of each task its result, by goal name, when racing a portfolio
+        vector<unordered_map<string, string> > winners(tasks);
+        vector<exception_ptr> errors(tasks);
+        // not vector<bool>, since workers write to it at the same time
+        vector<char> timedOut(tasks);
+        vector<char> cached(tasks);
+        vector<string> keys(tasks);
+        
+        // Look up every task in the cache first, so only the rest are put into batches.
+        if (cache) {
+            WorkerPool lookups(jobs, tasks, [&](size_t j) {
+                try {
+                    keys[j] = cache->getKey(taskList.getClosure(j));
+                    string found;
+                    cached[j] = cache->lookup(keys[j], found);
+                    if (cached[j]) {
+                        parseTaskOutput(found, results[j], logs[j]);
+                    }
+                } catch (...) {
+                    errors[j] = current_exception();
+                }
+            });
+            lookups.join();
+        }
+        vector<size_t> unproven;
+        for (size_t i = 0; i < tasks; i++) {
+            if (!cached[i] && !errors[i]) {
+                unproven.push_back(i);
+            }
+        }
+        
+        // Each worker takes the next batch of tasks not yet started, and runs Why3 on it.
+        // The size of a batch is estimated from the size of its tasks' theories, times the time per character of the tasks proven so far.
+        // Until some task is proven, there is nothing to go on, so tasks are proven one at a time.
+        // Tasks a stopped batch never got to are proven again, alone, before any new batch.
+        mutex batchMutex;
+        size_t nextTask = 0;
+        vector<size_t> retries;
+        double provenTime = 0, provenSize = 0;
+        // Each index of the pool is one worker, which runs Why3 on batch after batch until there are none left.
+        WorkerPool workers(jobs, min<size_t>(jobs, unproven.size()), [&](size_t) {
+            while (true) {
+                vector<size_t> batch;
+                {
+                    lock_guard<mutex> guard(batchMutex);
+                    if (!retries.empty()) {
+                        batch.push_back(retries.back());
+                        retries.pop_back();
+                    } else {
+                        // leave some tasks for every other worker
+                        size_t maxSize = min(MAX_BATCH_SIZE, max<size_t>(1, (unproven.size() - nextTask) / jobs));
+                        double estimate = 0;
+                        while (nextTask < unproven.size() && batch.size() < maxSize) {
+                            double cost = provenSize > 0 ? provenTime / provenSize * taskList.getTheoryText(unproven[nextTask]).size() : BATCH_TARGET_TIME;
+                            if (!batch.empty() && estimate + cost > BATCH_TARGET_TIME) break;
+                            batch.push_back(unproven[nextTask++]);
+                            estimate += cost;
+                        }
+                    }
+                }
+                if (batch.empty()) {
+                    break;
+                }
+                
+                try {
+                    vector<pair<string, string> > goals;
+                    for (size_t k = 0; k < batch.size(); k++) {
+                        vector<size_t>::iterator ii = batch.begin() + k;
+                        const vector<string> &names = taskList.getGoalNames(*ii);
+                        for (vector<string>::const_iterator jj = names.begin(); jj != names.end(); jj++) {
+                            goals.push_back(make_pair(taskList.getTheoryName(*ii), *jj));
+                        }
+                    }
+                    
+                    // the prover that won the most of the batch's goals last time goes first
+                    vector<string> order(provers);
+                    if (cache && provers.size() > 1) {
+                        unordered_map<string, unsigned> wins;
+                        string favorite;
+                        for (vector<pair<string, string> >::iterator ii = goals.begin(); ii != goals.end(); ii++) {
+                            string winner = cache->getWinner(module, ii->first, ii->second);
+                            if (winner.empty()) continue;
+                            unsigned count = ++wins[winner];
+                            if (favorite.empty() || count > wins[favorite]) {
+                                favorite = winner;
+                            }
+                        }
+                        vector<string>::iterator last = find(order.begin(), order.end(), favorite);
+                        if (last != order.end()) {
+                            rotate(order.begin(), last, last + 1);
+                        }
+                    }
+                    
+                    bool stopped;
+                    unordered_map<string, string> goalWinners;
+                    string result = raceWhy3Provers(taskList.getBatch(batch), goals, order, limits, goalWinners, stopped);
+                    vector<string> taskOutputs(batch.size());
+                    splitBatchOutput(result, taskList, batch, taskOutputs);
+                    
+                    Why3Output parsed(result.c_str());
+                    double time = 0, size = 0;
+                    for (list<Why3Goal>::iterator ii = parsed.goals.begin(); ii != parsed.goals.end(); ii++) {
+                        time += ii->time;
+                    }
+                    
+                    // Why3 proves goals in order, so if the watchdog stopped it, the first task missing a goal is the one that was stuck.
+                    // It alone timed out; the tasks after it were never got to, so they are proven again.
+                    vector<size_t> unfinished;
+                    bool foundStuck = false;
+                    for (size_t k = 0; k < batch.size(); k++) {
+                        vector<size_t>::iterator ii = batch.begin() + k;
+                        const vector<string> &names = taskList.getGoalNames(*ii);
+                        for (vector<string>::const_iterator jj = names.begin(); jj != names.end(); jj++) {
+                            unordered_map<string, string>::iterator winner = goalWinners.find(*jj);
+                            if (winner != goalWinners.end()) {
+                                winners[*ii][*jj] = winner->second;
+                            }
+                        }
+                        
+                        Why3Output taskResult;
+                        string log;
+                        parseTaskOutput(taskOutputs[k], taskResult, log);
+                        bool complete = !parsed.error && hasAllGoals(taskList, *ii, taskResult);
+                        if (stopped && !parsed.error && !complete) {
+                            if (!foundStuck) {
+                                foundStuck = true;
+                                timedOut[*ii] = true;
+                            } else {
+                                unfinished.push_back(*ii);
+                                winners[*ii].clear();
+                                continue;
+                            }
+                        }
+                        size += taskList.getTheoryText(*ii).size();
+                        
+                        // a task missing some goal's result would be missing it for good
+                        if (cache && complete) {
+                            cache->store(keys[*ii], taskResult);
+                        }
+                        results[*ii].merge(taskResult);
+                        logs[*ii] = log;
+                    }
+                    {
+                        lock_guard<mutex> guard(batchMutex);
+                        if (!parsed.error) {
+                            provenTime += time;
+                            provenSize += size;
+                        }
+                        retries.insert(retries.end(), unfinished.rbegin(), unfinished.rend());
+                    }
+                    // only a prover that proved or disproved a goal won it
+                    if (cache) {
+                        for (list<Why3Goal>::iterator ii = parsed.goals.begin(); ii != parsed.goals.end(); ii++) {
+                            unordered_map<string, string>::iterator winner = goalWinners.find(ii->goal);
+                            if (winner != goalWinners.end() && getStatusRank(ii->status) == 3) {
+                                cache->setWinner(module, ii->theory, ii->goal, winner->second);
+                            }
+                        }
+                    }
+                } catch (...) {
+                    errors[batch.front()] = current_exception();
+                }
+            }
+        });
+        workers.join();
+        
+        for (size_t i = 0; i < tasks; i++) {
+            if (errors[i]) {
+                rethrow_exception(errors[i]);
+            }
             
-            // scan to end of line
-            while (*str != '\n' && *str != '\0') {
-                str++;
+            raw << logs[i];
+            Why3Output &result = results[i];
+            if (timedOut[i] && !result.error) {
+                addTimedOutGoals(taskList, i, result, limits);
             }
-            if (*str != '\0') {
-                str++;
+            for (list<Why3Goal>::iterator ii = result.goals.begin(); ii != result.goals.end(); ii++) {
+                ii->cached = cached[i];
+                if (provers.size() > 1 && !cached[i]) {
+                    ii->prover = winners[i][ii->goal];
+                }
             }
+            out.merge(result);
         }
     }
     
+    void writeWhy3GoalResult(ostream &out, const Why3Goal &goal) {
+        switch (goal.status) {
+            case Why3Goal::STATUS_VALID: {
+                out << "Valid";
+                break;
+            }
+            case Why3Goal::STATUS_UNKNOWN: {
+                out << "Unknown";
+                break;
+            }
+            case Why3Goal::STATUS_FAIL: {
+                out << "Failure";
+                break;
+            }
+            case Why3Goal::STATUS_TIMEOUT: {
+                out << "Timeout";
+                break;
+            }
+            case Why3Goal::STATUS_OUT_OF_MEMORY: {
+                out << "OutOfMemory";
+                break;
+            }
+        }
+        out << " (" << goal.time << "s";
+        if (goal.steps != -1) {
+            out << ", " << goal.steps << " steps";
+        }
+        out << ")";
+    }
+    
+    Why3Output::Why3Output() {}
+    
+    Why3OutputParser::Why3OutputParser(function<void(const Why3GoalRef&)> onGoal, size_t otherLimit) : onGoal{onGoal}, otherLimit{otherLimit} {}
+    
+    Why3OutputParser::int_type Why3OutputParser::overflow(int_type c) {
+        if (c != traits_type::eof()) {
+            char ch = c;
+            feed(&ch, 1);
+        }
+        return c;
+    }
+    
+    streamsize Why3OutputParser::xsputn(const char* s, streamsize n) {
+        feed(s, n);
+        return n;
+    }
+    
+    void Why3OutputParser::feed(const char* data, size_t n) {
+        buffer.append(data, n);
+        
+        // parse each complete line in place, then drop them all at once
+        size_t start = 0;
+        for (size_t end = buffer.find('\n'); end != string::npos; end = buffer.find('\n', start)) {
+            parseLine(StringRef(buffer.data() + start, end - start));
+            start = end + 1;
+        }
+        buffer.erase(0, start);
+    }
+    
+    void Why3OutputParser::finish() {
+        if (!buffer.empty()) {
+            parseLine(StringRef(buffer));
+            buffer.clear();
+        }
+        if (sawLocation) {
+            // the output ended before saying what was at the location
+            error = true;
+            sawLocation = false;
+        }
+    }
+    
+    /**
+     * Parses the number at the start of str, like strtoul. Returns 0 if there is none.
+     */
+    static unsigned long parseNumber(StringRef str) {
+        size_t n = str.find_first_not_of(" ");
+        if (n == StringRef::npos) return 0;
+        str = str.substr(n);
+        unsigned long result = 0;
+        str.substr(0, str.find_first_not_of("0123456789")).getAsInteger(10, result);
+        return result;
+    }
+    
+    void Why3OutputParser::keepLine(StringRef text) {
+        if (otherLines.size() + text.size() + 1 > otherLimit) {
+            otherLinesCut = otherLimit > 0;
+            return;
+        }
+        otherLines.append(text.data(), text.size());
+        otherLines += '\n';
+    }
+    
+    void Why3OutputParser::parseLine(StringRef text) {
+        if (stopped) {
+            keepLine(text);
+            return;
+        }
+        
+        if (sawLocation) {
+            keepLine(text);
+            sawLocation = false;
+            if (!text.startswith("warning:")) {
+                error = true;
+                message = text.str();
+                stopped = true;
+            }
+            return;
+        }
+        
+        if (text.startswith("File \"")) {
+            keepLine(text);
+            // File "<file>", line <line>, characters <begin>-<end>: then an error or a warning on the next line
+            size_t pos = text.rfind(", line ");
+            if (pos != StringRef::npos) {
+                StringRef rest = text.substr(pos + 7);
+                line = parseNumber(rest);
+                pos = rest.find(", characters ");
+                if (pos != StringRef::npos) {
+                    rest = rest.substr(pos + 13);
+                    colBegin = parseNumber(rest);
+                    colEnd = parseNumber(rest.substr(rest.find('-') + 1));
+                }
+            }
+            sawLocation = true;
+            return;
+        }
+        
+        // <file> <theory> <goal> : <status> (<time>s[, <steps> steps])
+        Why3GoalRef goal;
+        pair<StringRef, StringRef> field = text.split(' ');
+        field = field.second.split(' ');
+        goal.theory = field.first;
+        field = field.second.split(' ');
+        goal.goal = field.first;
+        field = field.second.split(' ');
+        if (field.first != ":" || goal.goal.empty()) {
+            // not a goal
+            keepLine(text);
+            return;
+        }
+        field = field.second.split(' ');
+        
+        StringRef status = field.first;
+        bool highFailure = false;
+        if (status == "Valid") {
+            goal.status = Why3Goal::STATUS_VALID;
+        } else if (status == "Unknown") {
+            goal.status = Why3Goal::STATUS_UNKNOWN;
+        } else if (status == "Timeout") {
+            goal.status = Why3Goal::STATUS_TIMEOUT;
+        } else if (status == "OutOfMemory") {
+            goal.status = Why3Goal::STATUS_OUT_OF_MEMORY;
+        } else if (status == "Failure" || status == "Invalid") {
+            goal.status = Why3Goal::STATUS_FAIL;
+        } else if (status == "StepLimitExceeded") {
+            // running out of steps is running out of time, counted differently
+            goal.status = Why3Goal::STATUS_TIMEOUT;
+        } else if (status == "HighFailure") {
+            // if we had a high failure, the rest of the output is essentially unparsable. Don't even try.
+            goal.status = Why3Goal::STATUS_FAIL;
+            highFailure = true;
+        } else {
+            // a goal with a result we don't know; dropping it would make the goal look like it was never attempted
+            keepLine(text);
+            error = true;
+            message = "unknown result '" + status.str() + "' for goal '" + goal.goal.str() + "'";
+            stopped = true;
+            return;
+        }
+        
+        if (!highFailure) {
+            // the time and steps are in the last parentheses; some statuses have their own before them
+            size_t paren = text.rfind('(');
+            if (paren != StringRef::npos) {
+                StringRef times = text.substr(paren + 1);
+                // the text is followed by a newline or the end of the buffer, so strtod stops in time
+                goal.time = strtod(times.data(), NULL);
+                size_t comma = times.find(',');
+                if (comma != StringRef::npos) {
+                    goal.steps = parseNumber(times.substr(comma + 1));
+                }
+            }
+        }
+        
+        onGoal(goal);
+        if (highFailure) {
+            stopped = true;
+        }
+    }
+    
+    Why3Output::Why3Output(const char* str) {
+        Why3OutputParser parser([this](const Why3GoalRef &goal) {
+            addGoal(goal);
+        });
+        parser.feed(str, strlen(str));
+        parser.finish();
+        
+        addError(parser);
+    }
+    
+    void Why3Output::addError(const Why3OutputParser &parser) {
+        if (parser.error && !error) {
+            error = true;
+            message = parser.message.empty() ? NULL : strdup(parser.message.c_str());
+            line = parser.line;
+            colBegin = parser.colBegin;
+            colEnd = parser.colEnd;
+        }
+    }
+    
+    Why3Goal& Why3Output::addGoal(const Why3GoalRef &ref) {
+        Why3Goal goal;
+        goal.theory = strndup(ref.theory.data(), ref.theory.size());
+        goal.goal = strndup(ref.goal.data(), ref.goal.size());
+        goal.status = ref.status;
+        goal.time = ref.time;
+        goal.steps = ref.steps;
+        goals.push_back(goal);
+        return goals.back();
+    }
+    
     Why3Output::~Why3Output() {
         if (message) free(message);
         for (list<Why3Goal>::iterator ii = goals.begin(); ii != goals.end(); ii++) {
@@ -206,5 +1079,18 @@ namespace whyr {
             if (ii->goal) free(ii->goal);
         }
     }
+    
+    void Why3Output::merge(Why3Output &other) {
+        if (other.error && !error) {
+            error = true;
+            message = other.message ? strdup(other.message) : NULL;
+            line = other.line;
+            colBegin = other.colBegin;
+            colEnd = other.colEnd;
+        }
+        
+        // the goals' strings now belong to this output
+        goals.splice(goals.end(), other.goals);
+    }
 }
 
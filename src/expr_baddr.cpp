@@ -10,6 +10,7 @@
 #include <whyr/expressions.hpp>
 #include <whyr/types.hpp>
 #include <whyr/esc_why3.hpp>
+#include <whyr/exception.hpp>
 
 namespace whyr {
     using namespace std;
@@ -47,7 +48,16 @@ namespace whyr {
         if (func != data.source->func->rawIR()) data.info->funcsCalled.insert(func);
         data.info->usesBaddr = true;
         
-        out << "(store_baddr " << getWhy3BlockName(data.module->getFunction(func), block) << ")";
+        AnnotatedFunction* annotated = data.module->getFunction(func);
+        if (!annotated) {
+            throw whyr_exception(("internal error: Function '" + string(func->getName().data()) + "' has its blocks addressed, but was not annotated"), this);
+        }
+        out << "(store_baddr " << getWhy3BlockName(annotated, block) << ")";
+    }
+    
+    void LogicExpressionBlockAddress::getRequirements(Why3Data &data) {
+        if (func != data.source->func->rawIR()) data.info->funcsCalled.insert(func);
+        data.info->usesBaddr = true;
     }
     
     bool LogicExpressionBlockAddress::classof(const LogicExpression* expr) {
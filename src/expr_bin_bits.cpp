@@ -146,6 +146,11 @@ namespace whyr {
         out << ")";
     }
     
+    void LogicExpressionBinaryBits::getRequirements(Why3Data &data) {
+        lhs->getRequirements(data);
+        rhs->getRequirements(data);
+    }
+    
     bool LogicExpressionBinaryBits::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
@@ -74,6 +74,11 @@ namespace whyr {
         out << ")";
     }
     
+    void LogicExpressionBinaryBoolean::getRequirements(Why3Data &data) {
+        lhs->getRequirements(data);
+        rhs->getRequirements(data);
+    }
+    
     bool LogicExpressionBinaryBoolean::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
@@ -135,6 +135,11 @@ namespace whyr {
         out << ")";
     }
     
+    void LogicExpressionBinaryCompare::getRequirements(Why3Data &data) {
+        lhs->getRequirements(data);
+        rhs->getRequirements(data);
+    }
+    
     bool LogicExpressionBinaryCompare::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
@@ -186,6 +186,11 @@ namespace whyr {
         out << ")";
     }
     
+    void LogicExpressionBinaryCompareFloat::getRequirements(Why3Data &data) {
+        lhs->getRequirements(data);
+        rhs->getRequirements(data);
+    }
+    
     bool LogicExpressionBinaryCompareFloat::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
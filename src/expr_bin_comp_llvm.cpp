@@ -142,6 +142,11 @@ namespace whyr {
         out << ")";
     }
     
+    void LogicExpressionBinaryCompareLLVM::getRequirements(Why3Data &data) {
+        lhs->getRequirements(data);
+        rhs->getRequirements(data);
+    }
+    
     bool LogicExpressionBinaryCompareLLVM::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
@@ -262,7 +262,7 @@ namespace whyr {
                     // FIXME
                     
                     if (data.module->getSettings()) {
-                        data.module->getSettings()->warnings.push_back(whyr_warning("mod currently not supported on floats; using rem instead", this));
+                        addWhy3Warning(data.module, whyr_warning("mod currently not supported on floats; using rem instead", this));
                     }
                 }
                 case LogicExpressionBinaryMath::OP_REM: {
@@ -279,6 +279,19 @@ namespace whyr {
         out << ")";
     }
     
+    void LogicExpressionBinaryMath::getRequirements(Why3Data &data) {
+        if (isa<LogicTypeInt>(returnType())) {
+            if (op == LogicExpressionBinaryMath::OP_DIV || op == LogicExpressionBinaryMath::OP_MOD || op == LogicExpressionBinaryMath::OP_REM) {
+                data.importsNeeded.insert("int.ComputerDivision");
+            }
+        } else if (isa<LogicTypeLLVM>(returnType()) && cast<LogicTypeLLVM>(returnType())->getType()->isFPOrFPVectorTy()) {
+            data.importsNeeded.insert("floating_point.Rounding");
+        }
+        
+        lhs->getRequirements(data);
+        rhs->getRequirements(data);
+    }
+    
     bool LogicExpressionBinaryMath::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
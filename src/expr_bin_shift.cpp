@@ -101,6 +101,11 @@ namespace whyr {
         out << ")";
     }
     
+    void LogicExpressionBinaryShift::getRequirements(Why3Data &data) {
+        lhs->getRequirements(data);
+        rhs->getRequirements(data);
+    }
+    
     bool LogicExpressionBinaryShift::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
@@ -51,6 +51,10 @@ namespace whyr {
         out << ")";
     }
     
+    void LogicExpressionBitNot::getRequirements(Why3Data &data) {
+        rhs->getRequirements(data);
+    }
+    
     bool LogicExpressionBitNot::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
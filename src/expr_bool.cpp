@@ -50,6 +50,10 @@ namespace whyr {
         out << ")";
     }
     
+    void LogicExpressionBoolean::getRequirements(Why3Data &data) {
+        value->getRequirements(data);
+    }
+    
     bool LogicExpressionBoolean::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
@@ -41,6 +41,10 @@ namespace whyr {
         out << (value ? "true" : "false");
     }
     
+    void LogicExpressionBooleanConstant::getRequirements(Why3Data &data) {
+        data.importsNeeded.insert("bool.Bool");
+    }
+    
     bool LogicExpressionBooleanConstant::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
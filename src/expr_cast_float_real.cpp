@@ -53,6 +53,11 @@ namespace whyr {
         out << ")";
     }
     
+    void LogicExpressionFloatToReal::getRequirements(Why3Data &data) {
+        data.importsNeeded.insert("floating_point.Rounding");
+        expr->getRequirements(data);
+    }
+    
     bool LogicExpressionFloatToReal::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
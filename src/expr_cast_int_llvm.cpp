@@ -56,6 +56,10 @@ namespace whyr {
         out << ")";
     }
     
+    void LogicExpressionLogicIntToLLVMInt::getRequirements(Why3Data &data) {
+        expr->getRequirements(data);
+    }
+    
     bool LogicExpressionLogicIntToLLVMInt::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
@@ -70,6 +70,10 @@ namespace whyr {
         out << ")";
     }
     
+    void LogicExpressionIntToPointer::getRequirements(Why3Data &data) {
+        expr->getRequirements(data);
+    }
+    
     bool LogicExpressionIntToPointer::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
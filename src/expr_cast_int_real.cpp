@@ -53,6 +53,11 @@ namespace whyr {
         out << ")";
     }
     
+    void LogicExpressionIntToReal::getRequirements(Why3Data &data) {
+        data.importsNeeded.insert("real.FromInt");
+        expr->getRequirements(data);
+    }
+    
     bool LogicExpressionIntToReal::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
@@ -74,6 +74,10 @@ namespace whyr {
         out << ")";
     }
     
+    void LogicExpressionLLVMIntToLogicInt::getRequirements(Why3Data &data) {
+        expr->getRequirements(data);
+    }
+    
     bool LogicExpressionLLVMIntToLogicInt::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
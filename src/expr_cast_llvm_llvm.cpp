@@ -106,6 +106,14 @@ namespace whyr {
         out << ")";
     }
     
+    void LogicExpressionLLVMIntToLLVMInt::getRequirements(Why3Data &data) {
+        if (op == LogicExpressionLLVMIntToLLVMInt::OP_TRUNC) {
+            data.importsNeeded.insert("int.ComputerDivision");
+        }
+        
+        expr->getRequirements(data);
+    }
+    
     bool LogicExpressionLLVMIntToLLVMInt::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
@@ -68,6 +68,10 @@ namespace whyr {
         }
     }
     
+    void LogicExpressionPointerToInt::getRequirements(Why3Data &data) {
+        expr->getRequirements(data);
+    }
+    
     bool LogicExpressionPointerToInt::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
@@ -58,6 +58,11 @@ namespace whyr {
         out << "):(" << getWhy3FullName(cast<LogicTypeLLVM>(retType)->getType()) << "))";
     }
     
+    void LogicExpressionPointerToPointer::getRequirements(Why3Data &data) {
+        data.importsNeeded.insert("Pointer");
+        expr->getRequirements(data);
+    }
+    
     bool LogicExpressionPointerToPointer::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
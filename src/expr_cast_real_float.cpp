@@ -57,6 +57,11 @@ namespace whyr {
         out << ")";
     }
     
+    void LogicExpressionRealToFloat::getRequirements(Why3Data &data) {
+        data.importsNeeded.insert("floating_point.Rounding");
+        expr->getRequirements(data);
+    }
+    
     bool LogicExpressionRealToFloat::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
@@ -53,6 +53,11 @@ namespace whyr {
         out << ")";
     }
     
+    void LogicExpressionRealToInt::getRequirements(Why3Data &data) {
+        data.importsNeeded.insert("CustomTruncate");
+        expr->getRequirements(data);
+    }
+    
     bool LogicExpressionRealToInt::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
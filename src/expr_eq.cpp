@@ -68,6 +68,11 @@ namespace whyr {
         out << ")";
     }
     
+    void LogicExpressionEquals::getRequirements(Why3Data &data) {
+        lhs->getRequirements(data);
+        rhs->getRequirements(data);
+    }
+    
     bool LogicExpressionEquals::classof(const LogicExpression* type) {
         return type->id == classID;
     }
@@ -52,6 +52,11 @@ namespace whyr {
         out << ")";
     }
     
+    void LogicExpressionFresh::getRequirements(Why3Data &data) {
+        data.info->usesAlloc = true;
+        expr->getRequirements(data);
+    }
+    
     bool LogicExpressionFresh::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
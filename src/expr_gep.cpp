@@ -166,6 +166,28 @@ namespace whyr {
         out << "))):(" << getWhy3FullName(cast<LogicTypeLLVM>(retType)->getType()) << "))";
     }
     
+    void LogicExpressionGetElementPointer::getRequirements(Why3Data &data) {
+        data.importsNeeded.insert("Pointer");
+        expr->getRequirements(data);
+        
+        // struct indices are constants folded into the offset, so they contribute nothing
+        Type* currentType = cast<LogicTypeLLVM>(expr->returnType())->getType();
+        for (list<LogicExpression*>::iterator ii = elements->begin(); ii != elements->end(); ii++) {
+            if (currentType->isPointerTy()) {
+                (*ii)->getRequirements(data);
+                currentType = currentType->getPointerElementType();
+            } else if (currentType->isArrayTy()) {
+                (*ii)->getRequirements(data);
+                currentType = currentType->getArrayElementType();
+            } else if (currentType->isStructTy()) {
+                currentType = currentType->getStructElementType(getIntConstValue(*ii));
+            } else if (currentType->isVectorTy()) {
+                (*ii)->getRequirements(data);
+                currentType = currentType->getVectorElementType();
+            }
+        }
+    }
+    
     bool LogicExpressionGetElementPointer::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
@@ -116,6 +116,15 @@ namespace whyr {
         }
     }
     
+    void LogicExpressionGetIndex::getRequirements(Why3Data &data) {
+        lhs->getRequirements(data);
+        
+        // struct indices are rendered as field names, not expressions
+        if (!(isa<LogicTypeLLVM>(lhs->returnType()) && cast<LogicTypeLLVM>(lhs->returnType())->getType()->isStructTy())) {
+            rhs->getRequirements(data);
+        }
+    }
+    
     bool LogicExpressionGetIndex::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
@@ -73,6 +73,12 @@ namespace whyr {
         out << ")";
     }
     
+    void LogicExpressionConditional::getRequirements(Why3Data &data) {
+        condition->getRequirements(data);
+        ifTrue->getRequirements(data);
+        ifFalse->getRequirements(data);
+    }
+    
     bool LogicExpressionConditional::classof(const LogicExpression* type) {
         return type->id == classID;
     }
@@ -73,6 +73,18 @@ namespace whyr {
         out << ")";
     }
     
+    void LogicExpressionInSet::getRequirements(Why3Data &data) {
+        if (isa<LogicTypeLLVM>(itemExpr->returnType()) && cast<LogicTypeLLVM>(itemExpr->returnType())->getType()->isPointerTy()) {
+            data.importsNeeded.insert("MemorySet");
+        } else {
+            data.importsNeeded.insert("set.Set");
+        }
+        
+        itemExpr->getRequirements(data);
+        itemExpr->returnType()->getRequirements(data);
+        setExpr->getRequirements(data);
+    }
+    
     bool LogicExpressionInSet::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
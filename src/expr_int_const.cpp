@@ -44,6 +44,8 @@ namespace whyr {
         out << value;
     }
     
+    void LogicExpressionIntegerConstant::getRequirements(Why3Data &data) {}
+    
     bool LogicExpressionIntegerConstant::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
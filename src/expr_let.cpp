@@ -63,6 +63,13 @@ namespace whyr {
         expr->toWhy3(out, data);
     }
     
+    void LogicExpressionLet::getRequirements(Why3Data &data) {
+        for (list<pair<LogicLocal*, LogicExpression*>*>::iterator ii = locals->begin(); ii != locals->end(); ii++) {
+            (*ii)->second->getRequirements(data);
+        }
+        expr->getRequirements(data);
+    }
+    
     bool LogicExpressionLet::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
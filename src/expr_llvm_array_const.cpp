@@ -78,6 +78,12 @@ namespace whyr {
         }
     }
     
+    void LogicExpressionLLVMArrayConstant::getRequirements(Why3Data &data) {
+        for (list<LogicExpression*>::iterator ii = elements->begin(); ii != elements->end(); ii++) {
+            (*ii)->getRequirements(data);
+        }
+    }
+    
     bool LogicExpressionLLVMArrayConstant::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
@@ -43,6 +43,10 @@ namespace whyr {
         addOperand(out, data.module, value);
     }
     
+    void LogicExpressionLLVMConstant::getRequirements(Why3Data &data) {
+        getTypeInfo(*data.info, value->getType());
+    }
+    
     bool LogicExpressionLLVMConstant::classof(const LogicExpression* type) {
         return type->id == classID;
     }
@@ -45,6 +45,10 @@ namespace whyr {
         addOperand(out, data.module, operand);
     }
     
+    void LogicExpressionLLVMOperand::getRequirements(Why3Data &data) {
+        getTypeInfo(*data.info, operand->getType());
+    }
+    
     bool LogicExpressionLLVMOperand::classof(const LogicExpression* type) {
         return type->id == classID;
     }
@@ -90,6 +90,12 @@ namespace whyr {
         out << "}:" << getWhy3FullName(type) << ")";
     }
     
+    void LogicExpressionLLVMStructConstant::getRequirements(Why3Data &data) {
+        for (list<LogicExpression*>::iterator ii = elements->begin(); ii != elements->end(); ii++) {
+            (*ii)->getRequirements(data);
+        }
+    }
+    
     bool LogicExpressionLLVMStructConstant::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
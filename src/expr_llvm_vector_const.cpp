@@ -88,6 +88,12 @@ namespace whyr {
         }
     }
     
+    void LogicExpressionLLVMVectorConstant::getRequirements(Why3Data &data) {
+        for (list<LogicExpression*>::iterator ii = elements->begin(); ii != elements->end(); ii++) {
+            (*ii)->getRequirements(data);
+        }
+    }
+    
     bool LogicExpressionLLVMVectorConstant::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
@@ -59,6 +59,10 @@ namespace whyr {
         out << ")";
     }
     
+    void LogicExpressionLoad::getRequirements(Why3Data &data) {
+        expr->getRequirements(data);
+    }
+    
     bool LogicExpressionLoad::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
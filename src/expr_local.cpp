@@ -46,6 +46,8 @@ namespace whyr {
         out << getWhy3LocalName(local);
     }
     
+    void LogicExpressionLocal::getRequirements(Why3Data &data) {}
+    
     bool LogicExpressionLocal::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
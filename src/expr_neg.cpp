@@ -90,6 +90,14 @@ namespace whyr {
         }
     }
     
+    void LogicExpressionNegate::getRequirements(Why3Data &data) {
+        if (isa<LogicTypeLLVM>(rhs->returnType()) && cast<LogicTypeLLVM>(rhs->returnType())->getType()->isFPOrFPVectorTy()) {
+            data.importsNeeded.insert("floating_point.Rounding");
+        }
+        
+        rhs->getRequirements(data);
+    }
+    
     bool LogicExpressionNegate::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
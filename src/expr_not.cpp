@@ -52,6 +52,10 @@ namespace whyr {
         out << ")";
     }
     
+    void LogicExpressionNot::getRequirements(Why3Data &data) {
+        rhs->getRequirements(data);
+    }
+    
     bool LogicExpressionNot::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
@@ -73,6 +73,17 @@ namespace whyr {
         out << ")";
     }
     
+    void LogicExpressionOffset::getRequirements(Why3Data &data) {
+        if (isa<LogicTypeSet>(pointer->returnType())) {
+            data.importsNeeded.insert("MemorySet");
+        } else {
+            data.importsNeeded.insert("Pointer");
+        }
+        
+        pointer->getRequirements(data);
+        offset->getRequirements(data);
+    }
+    
     bool LogicExpressionOffset::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
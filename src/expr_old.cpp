@@ -51,6 +51,10 @@ namespace whyr {
         data.statepoint = oldState;
     }
     
+    void LogicExpressionOld::getRequirements(Why3Data &data) {
+        expr->getRequirements(data);
+    }
+    
     bool LogicExpressionOld::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
@@ -74,6 +74,13 @@ namespace whyr {
         expr->toWhy3(out, data);
     }
     
+    void LogicExpressionQuantifier::getRequirements(Why3Data &data) {
+        for (list<LogicLocal*>::iterator ii = locals->begin(); ii != locals->end(); ii++) {
+            (*ii)->type->getRequirements(data);
+        }
+        expr->getRequirements(data);
+    }
+    
     bool LogicExpressionQuantifier::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
@@ -65,6 +65,12 @@ namespace whyr {
         out << ")";
     }
     
+    void LogicExpressionRange::getRequirements(Why3Data &data) {
+        data.importsNeeded.insert("Range");
+        begin->getRequirements(data);
+        end->getRequirements(data);
+    }
+    
     bool LogicExpressionRange::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
@@ -48,6 +48,8 @@ namespace whyr {
         out << value;
     }
     
+    void LogicExpressionRealConstant::getRequirements(Why3Data &data) {}
+    
     bool LogicExpressionRealConstant::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
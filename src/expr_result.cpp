@@ -44,6 +44,8 @@ namespace whyr {
         out << "ret_val";
     }
     
+    void LogicExpressionResult::getRequirements(Why3Data &data) {}
+    
     bool LogicExpressionResult::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
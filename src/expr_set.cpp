@@ -96,6 +96,21 @@ namespace whyr {
         }
     }
     
+    void LogicExpressionCreateSet::getRequirements(Why3Data &data) {
+        if (isa<LogicTypeLLVM>(baseType) && cast<LogicTypeLLVM>(baseType)->getType()->isPointerTy()) {
+            data.importsNeeded.insert("MemorySet");
+        } else {
+            data.importsNeeded.insert("set.Set");
+        }
+        
+        for (list<LogicExpression*>::iterator ii = elems.begin(); ii != elems.end(); ii++) {
+            (*ii)->getRequirements(data);
+            (*ii)->returnType()->getRequirements(data);
+        }
+        
+        setType.getRequirements(data);
+    }
+    
     bool LogicExpressionCreateSet::classof(const LogicExpression* type) {
         return type->id == classID;
     }
@@ -120,6 +120,17 @@ namespace whyr {
         }
     }
     
+    void LogicExpressionSetIndex::getRequirements(Why3Data &data) {
+        lhs->getRequirements(data);
+        
+        // struct indices are rendered as field names, not expressions
+        if (!(isa<LogicTypeLLVM>(lhs->returnType()) && cast<LogicTypeLLVM>(lhs->returnType())->getType()->isStructTy())) {
+            rhs->getRequirements(data);
+        }
+        
+        value->getRequirements(data);
+    }
+    
     bool LogicExpressionSetIndex::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
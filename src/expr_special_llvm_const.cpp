@@ -96,6 +96,8 @@ namespace whyr {
         addLLVMIntConstant(out, data.module, cast<LogicTypeLLVM>(retType)->getType(), const_stream.str());
     }
     
+    void LogicExpressionSpecialLLVMConstant::getRequirements(Why3Data &data) {}
+    
     bool LogicExpressionSpecialLLVMConstant::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
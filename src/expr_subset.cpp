@@ -76,6 +76,17 @@ namespace whyr {
         out << ")";
     }
     
+    void LogicExpressionSubset::getRequirements(Why3Data &data) {
+        if (isa<LogicTypeLLVM>(cast<LogicTypeSet>(subExpr->returnType())->getType()) && cast<LogicTypeLLVM>(cast<LogicTypeSet>(subExpr->returnType())->getType())->getType()->isPointerTy()) {
+            data.importsNeeded.insert("MemorySet");
+        } else {
+            data.importsNeeded.insert("set.Set");
+        }
+        
+        subExpr->getRequirements(data);
+        superExpr->getRequirements(data);
+    }
+    
     bool LogicExpressionSubset::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
@@ -63,12 +63,14 @@ namespace whyr {
     
     void LogicExpressionVariable::toWhy3(ostream &out, Why3Data &data) {
         if (data.calleeTheoryName) {
-            out << getWhy3ArgName(data.calleeTheoryName, arg);
+            out << getWhy3ArgName(data.module, data.calleeTheoryName, arg);
         } else {
-            out << getWhy3VarName(arg);
+            out << getWhy3VarName(data.module, arg);
         }
     }
     
+    void LogicExpressionVariable::getRequirements(Why3Data &data) {}
+    
     bool LogicExpressionVariable::classof(const LogicExpression* expr) {
         return expr->id == classID;
     }
@@ -10,6 +10,7 @@
 #include <whyr/exception.hpp>
 #include <whyr/types.hpp>
 #include <whyr/expressions.hpp>
+#include <whyr/esc_why3.hpp>
 
 namespace whyr {
     using namespace std;
@@ -28,6 +29,9 @@ namespace whyr {
         for (list<AnnotatedInstruction*>::iterator ii = annotatedInsts.begin(); ii != annotatedInsts.end(); ii++) {
             delete *ii;
         }
+        
+        delete layout;
+        delete typeInfo;
     }
     
     static void addAssignsAssertions(AnnotatedFunction* func) {
@@ -236,6 +240,9 @@ namespace whyr {
         if (hasAssgins) {
             addAssignsAssertions(this);
         }
+        
+        // our clauses have changed, so our type info has too
+        invalidateTypeInfo();
     }
     
     Function* AnnotatedFunction::rawIR() {
@@ -265,12 +272,55 @@ namespace whyr {
         return &annotatedInsts;
     }
     
+    void AnnotatedFunction::indexAnnotatedInstructions() {
+        if (annotatedInsts.size() == annotatedInstsIndexed) {
+            // already up to date; return without writing anything, so lookups are safe from several threads at once
+            return;
+        } else if (annotatedInsts.size() < annotatedInstsIndexed) {
+            // instructions were removed; start over
+            annotatedInstsIndex.clear();
+            annotatedInstsIndexed = 0;
+        }
+        
+        // index only the instructions added since last time, which are at the end of the list
+        list<AnnotatedInstruction*>::iterator ii = annotatedInsts.end();
+        for (size_t i = annotatedInstsIndexed; i < annotatedInsts.size(); i++) {
+            ii--;
+        }
+        for (; ii != annotatedInsts.end(); ii++) {
+            // the first entry for an instruction wins, as it did when this was a linear search
+            annotatedInstsIndex.insert(make_pair((*ii)->rawIR(), *ii));
+        }
+        annotatedInstsIndexed = annotatedInsts.size();
+    }
+    
     AnnotatedInstruction* AnnotatedFunction::getAnnotatedInstruction(Instruction* inst) {
-        for (list<AnnotatedInstruction*>::iterator ii = annotatedInsts.begin(); ii != annotatedInsts.end(); ii++) {
-            if ((*ii)->rawIR() == inst) {
-                return *ii;
-            }
+        indexAnnotatedInstructions();
+        unordered_map<Instruction*, AnnotatedInstruction*>::iterator found = annotatedInstsIndex.find(inst);
+        if (found == annotatedInstsIndex.end()) {
+            return NULL;
         }
-        return NULL;
+        return found->second;
+    }
+    
+    FunctionLayout* AnnotatedFunction::getLayout() {
+        if (!layout) {
+            layout = new FunctionLayout(this);
+        }
+        return layout;
+    }
+    
+    TypeInfo* AnnotatedFunction::getTypeInfo() {
+        if (!typeInfo) {
+            typeInfo = new TypeInfo();
+            computeTypeInfo(*typeInfo, this);
+        }
+        return typeInfo;
+    }
+    
+    void AnnotatedFunction::invalidateTypeInfo() {
+        delete typeInfo;
+        typeInfo = NULL;
+        module->invalidateTypeInfo();
     }
 }
@@ -9,24 +9,147 @@
 
 #include <llvm/IRReader/IRReader.h>
 #include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <unordered_set>
+#include <system_error>
 
 namespace whyr {
     using namespace std;
     using namespace llvm;
-
-    AnnotatedModule* AnnotatedModule::moduleFromBitcode(istream& file, const char* file_name, WhyRSettings* settings) {
-        vector<char> buffer((istreambuf_iterator<char>(file)), (istreambuf_iterator<char>()));
-        char a[buffer.size()];
-        copy(buffer.begin(), buffer.end(), a);
+    
+    /**
+     * Reads the whole of a stream into a buffer on the heap. Returns NULL if there was a read error.
+     * If the stream can tell its size, as a file can, its contents are read straight into the buffer.
+     * Otherwise, as with a pipe, they are read in chunks and copied into the buffer once at the end.
+     */
+    static unique_ptr<MemoryBuffer> readStream(istream& file, const char* file_name) {
+        istream::pos_type start = file.tellg();
+        if (start != istream::pos_type(-1) && file.seekg(0, ios::end)) {
+            size_t size = file.tellg() - start;
+            file.seekg(start);
+            
+            unique_ptr<MemoryBuffer> buffer = MemoryBuffer::getNewUninitMemBuffer(size, file_name);
+            file.read(const_cast<char*>(buffer->getBufferStart()), size);
+            if ((size_t) file.gcount() != size) { // if there was a read error, don't even try passing in what we got to LLVM
+                return NULL;
+            }
+            return buffer;
+        }
         
-        if (file.fail()) { // if there was a read error, dson't even try passing in what we got to LLVM
+        file.clear();
+        string contents;
+        char chunk[65536];
+        while (file.read(chunk, sizeof(chunk)) || file.gcount() > 0) {
+            contents.append(chunk, file.gcount());
+        }
+        if (file.bad()) { // if there was a read error, don't even try passing in what we got to LLVM
+            return NULL;
+        }
+        return MemoryBuffer::getMemBufferCopy(contents, file_name);
+    }
+    
+    /**
+     * Maps a file into memory, without copying it if the system allows. Returns NULL if it could not be opened.
+     * The IR parser needs a null terminator; the bitcode parser doesn't, which lets every bitcode file be mapped.
+     */
+    static unique_ptr<MemoryBuffer> mapFile(const char* file_name, bool needsNullTerminator) {
+        ErrorOr<unique_ptr<MemoryBuffer>> buffer = MemoryBuffer::getFile(file_name, -1, needsNullTerminator);
+        if (!buffer) {
             return NULL;
         }
+        return move(*buffer);
+    }
+    
+    /**
+     * Returns true if a function has WhyR annotations, either on itself or on any of its instructions.
+     */
+    static bool hasAnnotations(Function* func) {
+        if (func->getMetadata("whyr.requires") || func->getMetadata("whyr.ensures") || func->getMetadata("whyr.assigns")) {
+            return true;
+        }
+        for (Function::iterator ii = func->begin(); ii != func->end(); ii++) {
+            for (BasicBlock::iterator jj = ii->begin(); jj != ii->end(); jj++) {
+                if (AnnotatedInstruction::isAnnotated(&*jj)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+    
+    /**
+     * Materializes the bodies of a lazily loaded module's annotated functions, and of every function they call, directly or not.
+     * Every other function is made a declaration, so only the part of the module being verified stays in memory.
+     * Annotations are stored with the bodies, so every body is still read once to look for them,
+     * but the bodies without any are dropped again right away.
+     */
+    static std::error_code materializeAnnotated(Module* mod) {
+        list<Function*> worklist;
+        for (Module::iterator ii = mod->begin(); ii != mod->end(); ii++) {
+            if (!ii->isMaterializable()) continue;
+            if (std::error_code error = ii->materialize()) {
+                return error;
+            }
+            if (hasAnnotations(&*ii)) {
+                worklist.push_back(&*ii);
+            } else {
+                ii->dematerialize();
+            }
+        }
         
+        // anything referred to by a function in the slice is in the slice, be it called or not
+        unordered_set<Function*> slice(worklist.begin(), worklist.end());
+        while (!worklist.empty()) {
+            Function* func = worklist.front();
+            worklist.pop_front();
+            
+            for (Function::iterator ii = func->begin(); ii != func->end(); ii++) {
+                for (BasicBlock::iterator jj = ii->begin(); jj != ii->end(); jj++) {
+                    for (User::op_iterator kk = jj->op_begin(); kk != jj->op_end(); kk++) {
+                        Function* callee = dyn_cast<Function>((*kk)->stripPointerCasts());
+                        if (callee && slice.insert(callee).second) {
+                            if (callee->isMaterializable()) {
+                                if (std::error_code error = callee->materialize()) {
+                                    return error;
+                                }
+                            }
+                            worklist.push_back(callee);
+                        }
+                    }
+                }
+            }
+        }
+        
+        for (Module::iterator ii = mod->begin(); ii != mod->end(); ii++) {
+            if (!slice.count(&*ii) && !ii->isDeclaration()) {
+                ii->deleteBody();
+            }
+        }
+        
+        // nothing is left to materialize; this just lets go of the bitcode reader and its buffer
+        return mod->materializeAllPermanently();
+    }
+    
+    /**
+     * Parses LLVM bitcode. If settings asks for lazy loading, only the functions materializeAnnotated keeps have bodies.
+     */
+    static AnnotatedModule* parseBitcode(unique_ptr<MemoryBuffer> buffer, WhyRSettings* settings) {
         LLVMContext* ctx = new LLVMContext();
-        MemoryBufferRef buf(StringRef(a, buffer.size()), StringRef(string(file_name)));
         
-        ErrorOr<unique_ptr<Module>> m = parseBitcodeFile(buf, *ctx);
+        if (settings && settings->lazyLoad) {
+            // the module reads function bodies out of the buffer as they are materialized, so it takes the buffer
+            ErrorOr<unique_ptr<Module>> m = getLazyBitcodeModule(move(buffer), *ctx);
+            
+            if (m && *m && !materializeAnnotated(m->get())) {
+                return new AnnotatedModule(*m, settings);
+            } else {
+                return NULL;
+            }
+        }
+        
+        // the module does not refer to the buffer afterwards
+        ErrorOr<unique_ptr<Module>> m = parseBitcodeFile(buffer->getMemBufferRef(), *ctx);
         
         if (m && *m) {
             return new AnnotatedModule(*m, settings);
@@ -35,21 +158,18 @@ namespace whyr {
         }
     }
     
-    AnnotatedModule* AnnotatedModule::moduleFromIR(istream& file, const char* file_name, WhyRSettings* settings) {
-        vector<char> buffer((istreambuf_iterator<char>(file)), (istreambuf_iterator<char>()));
-        buffer.push_back('\0');
-        char a[buffer.size()];
-        copy(buffer.begin(), buffer.end(), a);
-        
-        if (file.fail()) { // if there was a read error, dson't even try passing in what we got to LLVM
-            return NULL;
+    /**
+     * Parses LLVM IR. The buffer must be null-terminated. The module does not refer to the buffer afterwards.
+     * parseIR would take bitcode as well, but always loads all of it, so bitcode goes to parseBitcode instead.
+     */
+    static AnnotatedModule* parseIRBuffer(unique_ptr<MemoryBuffer> buffer, WhyRSettings* settings) {
+        if (isBitcode((const unsigned char*) buffer->getBufferStart(), (const unsigned char*) buffer->getBufferEnd())) {
+            return parseBitcode(move(buffer), settings);
         }
         
         LLVMContext* ctx = new LLVMContext();
         SMDiagnostic info;
-        MemoryBufferRef buf(StringRef(a, buffer.size()-1), StringRef(string(file_name)));
-        
-        unique_ptr<Module> m = parseIR(buf, info, *ctx);
+        unique_ptr<Module> m = parseIR(buffer->getMemBufferRef(), info, *ctx);
         
         if (m) {
             return new AnnotatedModule(m, settings);
@@ -57,4 +177,24 @@ namespace whyr {
             return NULL;
         }
     }
+    
+    AnnotatedModule* AnnotatedModule::moduleFromBitcode(istream& file, const char* file_name, WhyRSettings* settings) {
+        unique_ptr<MemoryBuffer> buffer = readStream(file, file_name);
+        return buffer ? parseBitcode(move(buffer), settings) : NULL;
+    }
+    
+    AnnotatedModule* AnnotatedModule::moduleFromIR(istream& file, const char* file_name, WhyRSettings* settings) {
+        unique_ptr<MemoryBuffer> buffer = readStream(file, file_name);
+        return buffer ? parseIRBuffer(move(buffer), settings) : NULL;
+    }
+    
+    AnnotatedModule* AnnotatedModule::moduleFromBitcodeFile(const char* file_name, WhyRSettings* settings) {
+        unique_ptr<MemoryBuffer> buffer = mapFile(file_name, false);
+        return buffer ? parseBitcode(move(buffer), settings) : NULL;
+    }
+    
+    AnnotatedModule* AnnotatedModule::moduleFromIRFile(const char* file_name, WhyRSettings* settings) {
+        unique_ptr<MemoryBuffer> buffer = mapFile(file_name, true);
+        return buffer ? parseIRBuffer(move(buffer), settings) : NULL;
+    }
 }
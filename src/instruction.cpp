@@ -114,12 +114,14 @@ namespace whyr {
     LogicExpression* AnnotatedInstruction::setAssumeClause(LogicExpression* expr) {
         LogicExpression* old = assume;
         assume = expr;
+        function->invalidateTypeInfo();
         return old;
     }
     
     LogicExpression* AnnotatedInstruction::setAssertClause(LogicExpression* expr) {
         LogicExpression* old = assert;
         assert = expr;
+        function->invalidateTypeInfo();
         return old;
     }
 }
@@ -40,6 +40,8 @@ namespace whyr {
         out << "(unknown type)";
     }
     
+    void LogicType::getRequirements(Why3Data &data) {}
+    
     LogicExpression::LogicExpression(NodeSource* source) : source{source} {}
     LogicExpression::~LogicExpression() {}
     
@@ -69,6 +71,8 @@ namespace whyr {
         out << "(unknown why3)";
     }
     
+    void LogicExpression::getRequirements(Why3Data &data) {}
+    
     NodeSource::NodeSource(AnnotatedFunction* func, Instruction* inst, Metadata* metadata) : func{func}, inst{inst}, metadata{metadata} {}
     NodeSource::NodeSource(NodeSource* other) {
         *this = *other;
@@ -14,12 +14,24 @@ This is where main() lies, as well as general functions for using this applicati
 #include <whyr/module.hpp>
 #include <whyr/rte.hpp>
 #include <whyr/exec_why3.hpp>
+#include <whyr/proof_cache.hpp>
+#include <whyr/manifest.hpp>
+#include <whyr/workers.hpp>
+#include <llvm/Support/Regex.h>
 
 #include <cstdlib>
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <vector>
 #include <cstring>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <errno.h>
+#include <sys/stat.h>
 
 #include "optionparser.h"
 
@@ -44,17 +56,30 @@ enum Options {
     ENABLE_RTE,
     DISABLE_GOALS,
     COMBINE_GOALS,
+    SHARED_GOALS,
     INPUT_FORMAT,
     VACUOUS_CHECKS,
     PROVE,
     PROVER,
+    JOBS,
+    TIME_LIMIT,
+    MEM_LIMIT,
+    PROOF_CACHE,
+    INCREMENTAL,
+    REPORT,
+    LAZY,
+    FUNCTION,
+    OUTPUT_DIR,
 };
 static const option::Descriptor usage[] = {
-    { UNKNOWN, 0, "", "", option::Arg::None,                        "USAGE: whyr [<option>...] <file>" },
+    { UNKNOWN, 0, "", "", option::Arg::None,                        "USAGE: whyr [<option>...] <file>..." },
     { UNKNOWN, 0, "", "", option::Arg::None,                        "OPTIONS:" },
     { HELP, 0, "h", "help", option::Arg::None,                      "    --help (-h)           - Prints this help information." },
     { VERSION, 0, "v", "version", option::Arg::None,                "    --version (-v)        - Prints version information and exits." },
     { OUTPUT, 0, "o", "output-file", requireArgument,               "    --output-file (-o)    - Send output to the given file." },
+    { OUTPUT_DIR, 0, "d", "output-dir", requireArgument,            "    --output-dir (-d)     - Processes every input file given, on '-j' threads at once." },
+    { UNKNOWN, 0, "", "", option::Arg::None,                        "                            Writes the output of each to a '.why' file in the given directory," },
+    { UNKNOWN, 0, "", "", option::Arg::None,                        "                            and with '-p', the results to a '.results' file. Prints one line per input." },
     { WHY3_INT_MODE, 0, "", "why3-ints", requireArgument,           "    --why3-ints           - Change how LLVM integers are modeled in Why3." },
     { UNKNOWN, 0, "", "", option::Arg::None,                        "                            Valid values: 'int', 'bv'" },
     { WHY3_FLOAT_MODE, 0, "", "why3-floats", requireArgument,       "    --why3-floats         - Change how LLVM floats are modeled in Why3." },
@@ -66,17 +91,376 @@ static const option::Descriptor usage[] = {
     { ENABLE_RTE, 0, "r", "rte", option::Arg::None,                 "    --rte (-r)            - Enables RTE assertion generation." },
     { DISABLE_GOALS, 0, "g", "no-goals", option::Arg::None,         "    --no-goals (-g)       - Disables goal generation. Only generates theories." },
     { COMBINE_GOALS, 0, "G", "combine-goals", option::Arg::None,    "    --combine-goals (-G)  - For each function, combines all goals into one." },
+    { SHARED_GOALS, 0, "s", "shared-goals", option::Arg::None,      "    --shared-goals (-s)   - Emits each function's blocks once, and makes goals clone them." },
     { INPUT_FORMAT, 0, "f", "format", requireArgument,              "    --format (-f)         - Change what input format WhyR reads input files as." },
     { UNKNOWN, 0, "", "", option::Arg::None,                        "                            Valid values: 'auto', 'bc', 'll'" },
+    { FUNCTION, 0, "F", "function", requireArgument,                "    --function (-F)       - Only verifies functions whose names match the given regular expression." },
+    { UNKNOWN, 0, "", "", option::Arg::None,                        "                            May be given more than once. Only the contracts of the functions they call are emitted." },
+    { LAZY, 0, "l", "lazy", option::Arg::None,                      "    --lazy (-l)           - Only loads the bodies of annotated functions from bitcode," },
+    { UNKNOWN, 0, "", "", option::Arg::None,                        "                            and of the functions they call. Other functions become declarations." },
     { VACUOUS_CHECKS, 0, "V", "vacuous-checks", option::Arg::None,  "    --vacuous-checks (-V) - If specified, adds vacuous assertions to all goals." },
     { UNKNOWN, 0, "", "", option::Arg::None,                        "                            A vacuous goal is intended to fail or time out." },
     { UNKNOWN, 0, "", "", option::Arg::None,                        "                            if a vacuous goal passes, there is a contradiction in logic." },
     { PROVE, 0, "p", "prove", option::Arg::None,                    "    --prove (-p)          - If specified, runs output through Why3 and displays results." },
-    { PROVER, 0, "P", "prover", requireArgument,                    "    --prover (-P)         - Specify the prover to run with '-p'. Default is 'alt-ergo'." },
+    { PROVER, 0, "P", "prover", requireArgument,                    "    --prover (-P)         - Specify the prover to run with '-p'. Default is 'alt-ergo'. A comma-separated list races the provers on each goal." },
+    { JOBS, 0, "j", "jobs", requireArgument,                        "    --jobs (-j)           - Generates goal theories on the given number of threads." },
+    { UNKNOWN, 0, "", "", option::Arg::None,                        "                            With '-p', also proves that many goals at once." },
+    { TIME_LIMIT, 0, "t", "time-limit", requireArgument,            "    --time-limit (-t)     - With '-p', the number of seconds each goal may take." },
+    { MEM_LIMIT, 0, "M", "mem-limit", requireArgument,              "    --mem-limit (-M)      - With '-p', the number of megabytes each prover may use." },
+    { PROOF_CACHE, 0, "c", "cache", requireArgument,                "    --cache (-c)          - With '-p', caches proof results in the given directory." },
+    { UNKNOWN, 0, "", "", option::Arg::None,                        "                            Goals that have not changed since they were cached are not proven again." },
+    { INCREMENTAL, 0, "i", "incremental", requireArgument,          "    --incremental (-i)    - With '-p', records what was proven in the given manifest file." },
+    { UNKNOWN, 0, "", "", option::Arg::None,                        "                            Functions that have not changed since, nor have their callees," },
+    { UNKNOWN, 0, "", "", option::Arg::None,                        "                            have no goals generated or proven." },
+    { REPORT, 0, "R", "report", requireArgument,                    "    --report (-R)         - Change how results are printed." },
+    { UNKNOWN, 0, "", "", option::Arg::None,                        "                            Valid values: 'text', 'json'" },
+    { UNKNOWN, 0, "", "", option::Arg::None,                        "                            'json' prints one JSON object per line for each goal," },
+    { UNKNOWN, 0, "", "", option::Arg::None,                        "                            then one with the time taken by each phase." },
     { 0, 0, 0, 0, 0, 0 }
 };
 
+/**
+ * Prints the result of a goal on one line.
+ */
+static void printGoal(std::ostream &out, whyr::Why3Goal &goal) {
+    out << goal.goal << ": ";
+    switch (goal.status) {
+        case whyr::Why3Goal::STATUS_VALID: {
+            out << "VALID";
+            break;
+        }
+        case whyr::Why3Goal::STATUS_FAIL: {
+            out << "FAILURE";
+            break;
+        }
+        case whyr::Why3Goal::STATUS_TIMEOUT: {
+            out << "TIMEOUT";
+            break;
+        }
+        case whyr::Why3Goal::STATUS_UNKNOWN: {
+            out << "UNKNOWN";
+            break;
+        }
+        case whyr::Why3Goal::STATUS_OUT_OF_MEMORY: {
+            out << "OUT OF MEMORY";
+            break;
+        }
+    }
+    out << " (" << goal.time << "s)";
+    if (goal.steps != -1) {
+        out << " (" << goal.steps << " steps)";
+    }
+    if (goal.cached) {
+        out << " (cached)";
+    }
+    if (!goal.prover.empty()) {
+        out << " (won by " << goal.prover << ")";
+    }
+    out << std::endl;
+}
+
+/**
+ * Prints a string as a JSON string literal.
+ */
+static void printJSONString(std::ostream &out, const char* str) {
+    out << '"';
+    for (const char* c = str; *c; c++) {
+        switch (*c) {
+            case '"': out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            case '\t': out << "\\t"; break;
+            default: {
+                if ((unsigned char) *c < 0x20) {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", *c);
+                    out << buf;
+                } else {
+                    out << *c;
+                }
+            }
+        }
+    }
+    out << '"';
+}
+
+/**
+ * Prints the result of a goal as a JSON object on one line.
+ * prover is the prover used when the goal does not say; empty if it is not known.
+ */
+static void printGoalJSON(std::ostream &out, whyr::Why3Goal &goal, const std::string &prover, const whyr::TheorySizeStreamBuf &sizes) {
+    out << "{\"type\":\"goal\",\"theory\":";
+    printJSONString(out, goal.theory);
+    out << ",\"goal\":";
+    printJSONString(out, goal.goal);
+    out << ",\"status\":";
+    switch (goal.status) {
+        case whyr::Why3Goal::STATUS_VALID: {
+            out << "\"valid\"";
+            break;
+        }
+        case whyr::Why3Goal::STATUS_FAIL: {
+            out << "\"failure\"";
+            break;
+        }
+        case whyr::Why3Goal::STATUS_TIMEOUT: {
+            out << "\"timeout\"";
+            break;
+        }
+        case whyr::Why3Goal::STATUS_UNKNOWN: {
+            out << "\"unknown\"";
+            break;
+        }
+        case whyr::Why3Goal::STATUS_OUT_OF_MEMORY: {
+            out << "\"out_of_memory\"";
+            break;
+        }
+    }
+    out << ",\"prover\":";
+    if (!goal.prover.empty()) {
+        printJSONString(out, goal.prover.c_str());
+    } else if (!prover.empty()) {
+        printJSONString(out, prover.c_str());
+    } else {
+        out << "null";
+    }
+    out << ",\"time\":" << goal.time;
+    out << ",\"steps\":";
+    if (goal.steps != -1) {
+        out << goal.steps;
+    } else {
+        out << "null";
+    }
+    out << ",\"cached\":" << (goal.cached ? "true" : "false");
+    out << ",\"size\":" << sizes.getSize(goal.theory) << "}" << std::endl;
+}
+
+/// The most bytes of Why3's output besides goal results kept to show when a goal fails.
+static const size_t WHY3_LOG_LIMIT = 65536;
+
+/**
+ * Returns the seconds since start, and moves start to now.
+ */
+static double lap(std::chrono::steady_clock::time_point &start) {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - start).count();
+    start = now;
+    return seconds;
+}
+
+/**
+ * Everything batch mode needs to process an input, besides the input itself. Every worker shares it, and only reads it.
+ */
+struct BatchConfig {
+    /// Copied for each input, so each gets its own warnings and errors.
+    whyr::WhyRSettings settings;
+    whyr::AnnotatedModule* (*fileFunc)(const char*, whyr::WhyRSettings*) = NULL;
+    bool prove = false;
+    bool jsonReport = false;
+    std::vector<std::string> provers;
+    whyr::Why3Limits limits;
+    whyr::Why3ProofCache* cache = NULL;
+};
+
+/**
+ * The outcome of one input in batch mode.
+ */
+struct BatchResult {
+    int exitCode = 0;
+    /// The warnings and errors of the input, each already prefixed with the input's name.
+    std::ostringstream diagnostics;
+    unsigned goals = 0;
+    unsigned valid = 0;
+    unsigned failed = 0;
+    double wall = 0;
+    bool done = false;
+};
+
+/**
+ * Processes one input in batch mode: writes its Why3 code to outputBase + ".why", and, if proving,
+ * the result of every goal to outputBase + ".results", in the format of the report.
+ * Each input has its own LLVMContext and AnnotatedModule, so inputs can be processed on different threads at once.
+ */
+static void processBatchInput(const BatchConfig &config, const std::string &input, const std::string &outputBase, BatchResult &result) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    whyr::WhyRSettings settings(config.settings);
+    // the inputs are already spread over the jobs, so each one is processed on a single thread
+    settings.jobs = 1;
+    
+    whyr::AnnotatedModule* mod = config.fileFunc(input.c_str(), &settings);
+    if (!mod) {
+        result.diagnostics << input << ": error: File could not be parsed" << std::endl;
+        result.exitCode = 1;
+        result.wall = lap(start);
+        return;
+    }
+    
+    try {
+        mod->annotate();
+        if (settings.rte) {
+            addRTE(mod);
+        }
+        
+        std::ostringstream generated;
+        whyr::TheorySizeStreamBuf theorySizes;
+        {
+            // the code is kept in memory only if it is proven, and measured only for a JSON report
+            std::ofstream fout(outputBase + ".why");
+            std::streambuf* sink = fout.rdbuf();
+            whyr::TeeStreamBuf keep(sink, generated.rdbuf());
+            if (config.prove) sink = &keep;
+            whyr::TeeStreamBuf measure(sink, &theorySizes);
+            if (config.jsonReport) sink = &measure;
+            std::ostream out(sink);
+            generateWhy3(out, mod);
+            out.flush();
+            fout.flush();
+            if (!fout) {
+                result.diagnostics << input << ": error: could not write '" << outputBase << ".why'" << std::endl;
+                result.exitCode = 1;
+            }
+        }
+        
+        for (std::list<whyr::whyr_warning>::iterator ii = settings.warnings.begin(); ii != settings.warnings.end(); ii++) {
+            if (!settings.noWarn) {
+                result.diagnostics << input << ": warning: ";
+                ii->printMessage(result.diagnostics);
+            }
+            if (settings.werror) result.exitCode = 1;
+        }
+        for (std::list<whyr::whyr_exception>::iterator ii = settings.errors.begin(); ii != settings.errors.end(); ii++) {
+            result.diagnostics << input << ": error: ";
+            ii->printMessage(result.diagnostics);
+            result.exitCode = 1;
+        }
+        
+        if (config.prove) {
+            whyr::Why3Output why3out;
+            std::ostringstream raw;
+            whyr::proveWhy3Tasks(generated.str(), why3out, raw, 1, config.provers, config.limits, config.cache, input);
+            
+            if (why3out.error) {
+                result.diagnostics << input << ": error: in executing why3: " << why3out.message;
+                result.exitCode = 1;
+            } else {
+                std::ofstream results(outputBase + ".results");
+                std::string defaultProver = config.provers.size() == 1 ? config.provers[0] : "";
+                for (std::list<whyr::Why3Goal>::iterator ii = why3out.goals.begin(); ii != why3out.goals.end(); ii++) {
+                    if (config.jsonReport) {
+                        printGoalJSON(results, *ii, defaultProver, theorySizes);
+                    } else {
+                        printGoal(results, *ii);
+                    }
+                    result.goals++;
+                    if (ii->status == whyr::Why3Goal::STATUS_VALID) {
+                        result.valid++;
+                    } else if (ii->status == whyr::Why3Goal::STATUS_FAIL) {
+                        result.failed++;
+                    }
+                }
+            }
+        }
+    } catch (whyr::whyr_exception &ex) {
+        result.diagnostics << input << ": error: ";
+        ex.printMessage(result.diagnostics);
+        result.exitCode = 1;
+    } catch (std::exception &ex) {
+        result.diagnostics << input << ": error: " << ex.what() << std::endl;
+        result.exitCode = 1;
+    }
+    
+    delete mod;
+    result.wall = lap(start);
+}
+
+/**
+ * Processes many inputs at once, on up to 'jobs' threads, writing the output of each into outputDir.
+ * The record and diagnostics of each input are printed in the order the inputs were given, as soon as each is done.
+ * Returns the exit code: 1 if any input failed, 0 otherwise.
+ */
+static int runBatch(const BatchConfig &config, const std::vector<std::string> &inputs, const std::string &outputDir, unsigned jobs) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (mkdir(outputDir.c_str(), 0777) && errno != EEXIST) {
+        std::cerr << "error: could not create output directory '" << outputDir << "'" << std::endl;
+        return 1;
+    }
+    
+    // each input is written under its file name without the extension, so two inputs must not share one
+    std::vector<std::string> outputBases;
+    std::map<std::string, std::string> owners;
+    for (std::vector<std::string>::const_iterator ii = inputs.begin(); ii != inputs.end(); ii++) {
+        size_t slash = ii->rfind('/');
+        std::string name = slash == std::string::npos ? *ii : ii->substr(slash + 1);
+        size_t dot = name.rfind('.');
+        if (dot != std::string::npos && dot > 0) {
+            name = name.substr(0, dot);
+        }
+        if (owners.count(name)) {
+            std::cerr << "error: inputs '" << owners[name] << "' and '" << *ii << "' would both be written to '" << outputDir << "/" << name << ".why'" << std::endl;
+            return 1;
+        }
+        owners[name] = *ii;
+        outputBases.push_back(outputDir + "/" + name);
+    }
+    
+    // Each worker takes the next input not yet started.
+    std::vector<BatchResult> results(inputs.size());
+    std::mutex doneMutex;
+    std::condition_variable doneCond;
+    whyr::WorkerPool workers(jobs, inputs.size(), [&](size_t j) {
+        processBatchInput(config, inputs[j], outputBases[j], results[j]);
+        {
+            std::lock_guard<std::mutex> lock(doneMutex);
+            results[j].done = true;
+        }
+        doneCond.notify_all();
+    });
+    
+    // Meanwhile, report each input in order as soon as it is done.
+    int exitCode = 0;
+    unsigned failedInputs = 0;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        BatchResult &result = results[i];
+        {
+            std::unique_lock<std::mutex> lock(doneMutex);
+            doneCond.wait(lock, [&result]() { return result.done; });
+        }
+        
+        std::cerr << result.diagnostics.str();
+        if (result.exitCode) {
+            exitCode = result.exitCode;
+            failedInputs++;
+        }
+        
+        if (config.jsonReport) {
+            std::cout << "{\"type\":\"input\",\"input\":";
+            printJSONString(std::cout, inputs[i].c_str());
+            std::cout << ",\"output\":";
+            printJSONString(std::cout, (outputBases[i] + ".why").c_str());
+            std::cout << ",\"exit\":" << result.exitCode << ",\"wall\":" << result.wall;
+            if (config.prove) {
+                std::cout << ",\"goals\":" << result.goals << ",\"valid\":" << result.valid << ",\"failed\":" << result.failed;
+            }
+            std::cout << "}" << std::endl;
+        } else {
+            std::cout << inputs[i] << ": " << (result.exitCode ? "ERROR" : (result.failed ? "FAILURE" : "OK"));
+            if (config.prove) {
+                std::cout << " (" << result.valid << "/" << result.goals << " goals valid)";
+            }
+            std::cout << " (" << result.wall << "s)" << std::endl;
+        }
+    }
+    
+    workers.join();
+    
+    if (config.jsonReport) {
+        std::cout << "{\"type\":\"summary\",\"wall\":" << lap(start) << ",\"inputs\":" << inputs.size() << ",\"errors\":" << failedInputs << "}" << std::endl;
+    }
+    return exitCode;
+}
+
 int main(int argc, char** argv) {
+    std::chrono::steady_clock::time_point mainStart = std::chrono::steady_clock::now();
     argc-=(argc>0); argv+=(argc>0);
     option::Stats  stats(usage, argc, argv);
     option::Option options[stats.options_max];
@@ -113,6 +497,12 @@ int main(int argc, char** argv) {
         return 0;
     }
     
+    bool batch = parse.nonOptionsCount() > 1 || options[OUTPUT_DIR];
+    if (batch && !options[OUTPUT_DIR]) {
+        std::cerr << "error: more than one input file needs option --output-dir" << std::endl;
+        return 1;
+    }
+    
     whyr::WhyRSettings settings;
     
     if (options[WHY3_INT_MODE]) {
@@ -144,7 +534,54 @@ int main(int argc, char** argv) {
     if (options[ENABLE_RTE]) settings.rte = true;
     if (options[DISABLE_GOALS]) settings.noGoals = true;
     if (options[COMBINE_GOALS]) settings.combineGoals = true;
+    if (options[SHARED_GOALS]) settings.sharedGoals = true;
     if (options[VACUOUS_CHECKS]) settings.vacuousChecks = true;
+    if (options[LAZY]) settings.lazyLoad = true;
+    
+    for (option::Option* opt = options[FUNCTION]; opt; opt = opt->next()) {
+        std::string error;
+        llvm::Regex filter(opt->arg);
+        if (!filter.isValid(error)) {
+            std::cerr << "error: invalid option to " << options[FUNCTION].name << ": Invalid regular expression '" << opt->arg << "': " << error << std::endl;
+            return 1;
+        }
+        settings.functionFilters.push_back(opt->arg);
+    }
+    
+    if (options[JOBS]) {
+        std::string optstr(options[JOBS].arg);
+        char* end;
+        unsigned long jobs = strtoul(optstr.c_str(), &end, 10);
+        if (*end || optstr.empty() || jobs < 1) {
+            std::cerr << "error: invalid option to " << options[JOBS].name << ": Expected a positive number of jobs, got '" << optstr << "'" << std::endl;
+            return 1;
+        }
+        settings.jobs = jobs;
+    }
+    
+    if (options[TIME_LIMIT]) {
+        std::string optstr(options[TIME_LIMIT].arg);
+        char* end;
+        unsigned long limit = strtoul(optstr.c_str(), &end, 10);
+        if (*end || optstr.empty() || limit < 1) {
+            std::cerr << "error: invalid option to " << options[TIME_LIMIT].name << ": Expected a positive number of seconds, got '" << optstr << "'" << std::endl;
+            return 1;
+        }
+        settings.proverTimeLimit = limit;
+    }
+    
+    if (options[MEM_LIMIT]) {
+        std::string optstr(options[MEM_LIMIT].arg);
+        char* end;
+        unsigned long limit = strtoul(optstr.c_str(), &end, 10);
+        if (*end || optstr.empty() || limit < 1) {
+            std::cerr << "error: invalid option to " << options[MEM_LIMIT].name << ": Expected a positive number of megabytes, got '" << optstr << "'" << std::endl;
+            return 1;
+        }
+        settings.proverMemLimit = limit;
+    }
+    
+    if (options[PROOF_CACHE]) settings.proofCache = options[PROOF_CACHE].arg;
     
     if (options[WHY3_MEM_MODEL]) {
         std::string optstr(options[WHY3_MEM_MODEL].arg);
@@ -158,27 +595,93 @@ int main(int argc, char** argv) {
         }
     }
     
+    // stdin is read through a stream; files are mapped into memory
     whyr::AnnotatedModule* (*modFunc)(std::istream&, const char*, whyr::WhyRSettings*) = whyr::AnnotatedModule::moduleFromIR;
+    whyr::AnnotatedModule* (*fileFunc)(const char*, whyr::WhyRSettings*) = whyr::AnnotatedModule::moduleFromIRFile;
     if (options[INPUT_FORMAT]) {
         std::string optstr(options[INPUT_FORMAT].arg);
         if (optstr.compare("auto") == 0) {
             modFunc = whyr::AnnotatedModule::moduleFromIR;
+            fileFunc = whyr::AnnotatedModule::moduleFromIRFile;
         } else if (optstr.compare("bc") == 0) {
             modFunc = whyr::AnnotatedModule::moduleFromBitcode;
+            fileFunc = whyr::AnnotatedModule::moduleFromBitcodeFile;
         } else if (optstr.compare("ll") == 0) {
             modFunc = whyr::AnnotatedModule::moduleFromIR;
+            fileFunc = whyr::AnnotatedModule::moduleFromIRFile;
         } else {
             std::cerr << "error: invalid option to " << options[INPUT_FORMAT].name << ": Unknown input format '" << optstr << "'" << std::endl;
             return 1;
         }
     }
     
+    bool jsonReport = false;
+    if (options[REPORT]) {
+        std::string optstr(options[REPORT].arg);
+        if (optstr.compare("json") == 0) {
+            jsonReport = true;
+        } else if (optstr.compare("text") != 0) {
+            std::cerr << "error: invalid option to " << options[REPORT].name << ": Unknown report format '" << optstr << "'" << std::endl;
+            return 1;
+        }
+    }
+    
+    // A comma-separated list of provers is a portfolio; each task is proven by whichever finishes first.
+    std::string prover = options[PROVER] ? options[PROVER].arg : whyr::PROVER_ALT_ERGO;
+    std::vector<std::string> provers;
+    for (size_t start = 0, end; start <= prover.size(); start = end + 1) {
+        end = prover.find(',', start);
+        if (end == std::string::npos) end = prover.size();
+        if (end > start) provers.push_back(prover.substr(start, end - start));
+    }
+    if (provers.empty()) {
+        std::cerr << "error: no prover given" << std::endl;
+        return 1;
+    }
+    whyr::Why3Limits limits;
+    limits.time = settings.proverTimeLimit;
+    limits.memory = settings.proverMemLimit;
+    
+    if (batch) {
+        if (options[OUTPUT] || options[INCREMENTAL]) {
+            std::cerr << "error: option " << (options[OUTPUT] ? options[OUTPUT].name : options[INCREMENTAL].name) << " cannot be used with " << options[OUTPUT_DIR].name << std::endl;
+            return 1;
+        }
+        
+        std::vector<std::string> inputs;
+        for (int i = 0; i < parse.nonOptionsCount(); i++) {
+            if (strncmp(parse.nonOption(i), "-", 2) == 0) {
+                std::cerr << "error: standard input cannot be read with " << options[OUTPUT_DIR].name << std::endl;
+                return 1;
+            }
+            inputs.push_back(parse.nonOption(i));
+        }
+        
+        BatchConfig config;
+        config.settings = settings;
+        config.fileFunc = fileFunc;
+        config.prove = options[PROVE];
+        config.jsonReport = jsonReport;
+        config.provers = provers;
+        config.limits = limits;
+        if (options[PROVE] && !settings.proofCache.empty()) {
+            config.cache = new whyr::Why3ProofCache(settings.proofCache, prover, limits);
+        }
+        
+        int exitCode = runBatch(config, inputs, options[OUTPUT_DIR].arg, settings.jobs);
+        delete config.cache;
+        return exitCode;
+    }
+    
+    // the time taken by each phase, for the report
+    std::chrono::steady_clock::time_point phaseStart = std::chrono::steady_clock::now();
+    double parseTime = 0, annotateTime = 0, rteTime = 0, typesTime = 0, emitTime = 0, proveTime = 0;
+    
     whyr::AnnotatedModule* mod;
     if (strncmp(input_file, "-", 2) == 0) {
         mod = modFunc(std::cin, "<stdin>", &settings);
     } else {
-        std::ifstream file(input_file, std::ios::binary);
-        mod = modFunc(file, input_file, &settings);
+        mod = fileFunc(input_file, &settings);
     }
     
     if (!mod) {
@@ -186,22 +689,74 @@ int main(int argc, char** argv) {
         return 1;
     }
     
+    parseTime = lap(phaseStart);
+    
     mod->annotate();
+    annotateTime = lap(phaseStart);
     
     if (settings.rte) {
         addRTE(mod);
     }
+    rteTime = lap(phaseStart);
     
-    std::ostringstream out;
-    generateWhy3(out, mod);
+    // generateWhy3 would do this on its own; doing it first lets it be timed separately
+    mod->getTypeInfo();
+    typesTime = lap(phaseStart);
+    
+    // Everything that changes the goals, or how they are proven, invalidates the whole manifest.
+    if (options[PROVE] && options[INCREMENTAL]) {
+        std::ostringstream context;
+        context << "prover=" << prover << " time=" << limits.time << " memory=" << limits.memory;
+        context << " ints=" << settings.why3IntMode << " floats=" << settings.why3FloatMode << " model=" << settings.why3MemModel;
+        context << " rte=" << settings.rte << " combine=" << settings.combineGoals << " shared=" << settings.sharedGoals << " vacuous=" << settings.vacuousChecks;
+        // lazy loading leaves the bodies of unannotated callees out of their callers' goals
+        context << " lazy=" << settings.lazyLoad;
+        // function filters are left out, since the functions they leave out keep what was saved for them
+        settings.manifest = new whyr::Why3Manifest(options[INCREMENTAL].arg, context.str());
+    }
+    
+    // Stream the output to wherever it needs to go as it is generated, instead of keeping it all in memory.
+    // Proving on several processes, with a cache, or with a portfolio needs the whole output to split it into tasks, so in that case it is kept.
+    bool proveTasks = options[PROVE] && (settings.jobs > 1 || !settings.proofCache.empty() || provers.size() > 1);
+    whyr::Why3Process* why3 = NULL;
+    if (options[PROVE] && !proveTasks) {
+        why3 = new whyr::Why3Process(false, provers[0], limits);
+    }
+    std::ostringstream generated;
+    
+    // with a JSON report, the size of each theory is measured as it goes by
+    whyr::TheorySizeStreamBuf theorySizes;
+    auto generate = [&](std::ostream &out) {
+        if (jsonReport) {
+            whyr::TeeStreamBuf tee(out.rdbuf(), &theorySizes);
+            std::ostream measured(&tee);
+            generateWhy3(measured, mod);
+            measured.flush();
+        } else {
+            generateWhy3(out, mod);
+        }
+    };
     
     if (options[OUTPUT]) {
         std::ofstream fout(options[OUTPUT].arg);
-        fout << out.str();
+        if (why3 || proveTasks) {
+            whyr::TeeStreamBuf tee(fout.rdbuf(), why3 ? why3->getInput().rdbuf() : generated.rdbuf());
+            std::ostream out(&tee);
+            generate(out);
+            out.flush();
+        } else {
+            generate(fout);
+        }
         fout.flush();
-    } else if (!options[PROVE]) {
-        std::cout << out.str();
+    } else if (why3) {
+        generate(why3->getInput());
+    } else if (proveTasks) {
+        generate(generated);
+    } else {
+        generate(std::cout);
+        std::cout.flush();
     }
+    emitTime = lap(phaseStart);
     
     int exitCode = 0;
     
@@ -220,49 +775,100 @@ int main(int argc, char** argv) {
     }
     
     if (options[PROVE]) {
-        std::string pin = out.str();
         std::ostringstream pout;
-        whyr::execWhy3(pin, pout, false, options[PROVER] ? options[PROVER].arg : whyr::PROVER_ALT_ERGO);
+        whyr::Why3Output why3out;
+        // goals printed as they were proven; the rest are printed once proving is done
+        size_t printed = 0;
+        std::string defaultProver = provers.size() == 1 ? provers[0] : "";
+        auto report = [&](whyr::Why3Goal &goal) {
+            if (jsonReport) {
+                printGoalJSON(std::cout, goal, defaultProver, theorySizes);
+            } else {
+                printGoal(std::cout, goal);
+            }
+        };
+        
+        whyr::Why3ProofCache* cache = NULL;
+        try {
+            if (why3) {
+                // only the lines that are not goal results are kept, to show if a goal fails
+                whyr::Why3OutputParser parser([&](const whyr::Why3GoalRef &goal) {
+                    report(why3out.addGoal(goal));
+                    printed++;
+                }, WHY3_LOG_LIMIT);
+                std::ostream out(&parser);
+                why3->finish(out);
+                out.flush();
+                parser.finish();
+                why3out.addError(parser);
+                pout << parser.otherLines;
+                if (parser.otherLinesCut) {
+                    pout << "..." << std::endl;
+                }
+                
+                if (why3->hitTimeLimit()) {
+                    std::cerr << "error: why3 went over the time limit and was stopped; goals not listed were not attempted" << std::endl;
+                    exitCode = 1;
+                }
+            } else {
+                if (!settings.proofCache.empty()) {
+                    cache = new whyr::Why3ProofCache(settings.proofCache, prover, limits);
+                }
+                whyr::proveWhy3Tasks(generated.str(), why3out, pout, settings.jobs, provers, limits, cache, input_file);
+            }
+        } catch (whyr::whyr_exception &ex) {
+            std::cerr << "error: ";
+            ex.printMessage(std::cerr);
+            delete why3;
+            delete cache;
+            delete settings.manifest;
+            delete mod;
+            return 1;
+        }
+        delete why3;
+        delete cache;
+        
+        if (settings.manifest) {
+            settings.manifest->addResults(why3out);
+            settings.manifest->getReusedResults(why3out);
+            if (!why3out.error) {
+                settings.manifest->save();
+            }
+            delete settings.manifest;
+        }
+        
+        proveTime = lap(phaseStart);
         
-        whyr::Why3Output why3out(pout.str().c_str());
         if (why3out.error) {
             std::cerr << "error: in executing why3: " << why3out.message;
         } else {
-            for (std::list<whyr::Why3Goal>::iterator ii = why3out.goals.begin(); ii != why3out.goals.end(); ii++) {
-                std::cout << ii->goal << ": ";
-                switch (ii->status) {
-                    case whyr::Why3Goal::STATUS_VALID: {
-                        std::cout << "VALID";
-                        break;
-                    }
-                    case whyr::Why3Goal::STATUS_FAIL: {
-                        std::cout << "FAILURE";
-                        break;
-                    }
-                    case whyr::Why3Goal::STATUS_TIMEOUT: {
-                        std::cout << "TIMEOUT";
-                        break;
-                    }
-                    case whyr::Why3Goal::STATUS_UNKNOWN: {
-                        std::cout << "UNKNOWN";
-                        break;
-                    }
+            bool failed = false;
+            size_t i = 0;
+            for (std::list<whyr::Why3Goal>::iterator ii = why3out.goals.begin(); ii != why3out.goals.end(); ii++, i++) {
+                if (i >= printed) {
+                    report(*ii);
                 }
-                std::cout << " (" << ii->time << "s)";
-                if (ii->steps != -1) {
-                    std::cout << " (" << ii->steps << " steps)";
-                }
-                std::cout << std::endl;
-                
                 if (ii->status == whyr::Why3Goal::STATUS_FAIL) {
-                    std::cout << "=== Why3 stdout:" << std::endl;
-                    std::cout << pout.str();
-                    std::cout << "===" << std::endl;
+                    failed = true;
                 }
             }
+            
+            // JSON reports are read by other programs, which have no use for the raw output
+            if (failed && !jsonReport) {
+                std::cout << "=== Why3 stdout, without goal results:" << std::endl;
+                std::cout << pout.str();
+                std::cout << "===" << std::endl;
+            }
         }
     }
     
+    // the summary goes to standard output too, unless the Why3 code is there
+    if (jsonReport && (options[PROVE] || options[OUTPUT])) {
+        std::cout << "{\"type\":\"summary\",\"wall\":" << lap(mainStart);
+        std::cout << ",\"phases\":{\"parse\":" << parseTime << ",\"annotate\":" << annotateTime << ",\"rte\":" << rteTime;
+        std::cout << ",\"types\":" << typesTime << ",\"emit\":" << emitTime << ",\"prove\":" << proveTime << "}}" << std::endl;
+    }
+    
     delete mod;
     return exitCode;
 }
@@ -0,0 +1,325 @@
+/*
+ * manifest.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include <whyr/manifest.hpp>
+#include <whyr/exception.hpp>
+
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/IR/ModuleSlotTracker.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/ADT/SmallString.h>
+
+#include <fstream>
+#include <set>
+#include <map>
+
+#include <stdio.h>
+#include <ctype.h>
+#include <unistd.h>
+
+namespace whyr {
+    using namespace std;
+    using namespace llvm;
+    
+    /// The first line of every manifest file. Change this if the format changes.
+    static const string MANIFEST_HEADER("whyr manifest 1");
+    
+    /**
+     * Removes the numbers of metadata nodes, such as the 12 in "!whyr.assert !12", from the text of IR or an annotation.
+     * Metadata nodes are numbered across the whole module, so their numbers change when any other function changes.
+     * The annotations the metadata holds are hashed separately, from their parsed forms.
+     */
+    static string stripMetadataNumbers(const string &text) {
+        string result;
+        result.reserve(text.size());
+        for (size_t i = 0; i < text.size(); i++) {
+            result += text[i];
+            if (text[i] == '!') {
+                while (i + 1 < text.size() && isdigit(text[i + 1])) i++;
+            }
+        }
+        return result;
+    }
+    
+    /**
+     * Returns the text of an LLVM value, without metadata numbers.
+     * The slot tracker numbers the module's values once, rather than on every value printed.
+     */
+    static string getIRText(Value* value, ModuleSlotTracker &slots) {
+        string text;
+        raw_string_ostream stream(text);
+        value->print(stream, slots);
+        return stripMetadataNumbers(stream.str());
+    }
+    
+    /**
+     * Returns the text of an LLVM type.
+     */
+    static string getIRText(Type* type) {
+        string text;
+        raw_string_ostream stream(text);
+        type->print(stream);
+        return stream.str();
+    }
+    
+    static string getHash(MD5 &hash) {
+        MD5::MD5Result result;
+        hash.final(result);
+        SmallString<32> hex;
+        MD5::stringifyResult(result, hex);
+        return hex.str().str();
+    }
+    
+    Why3Manifest::Why3Manifest(const string &path, const string &context) : path{path}, context{context}, slots{NULL} {
+        ifstream file(path);
+        string line;
+        if (!getline(file, line) || line != MANIFEST_HEADER) {
+            return;
+        }
+        if (!getline(file, line) || line != "context " + context) {
+            // the goals or provers changed, so none of the saved results hold
+            return;
+        }
+        
+        while (getline(file, line)) {
+            // function <fingerprint> <number of results> <name>
+            istringstream header(line);
+            string keyword, fingerprint, name;
+            unsigned count;
+            if (!(header >> keyword >> fingerprint >> count) || keyword != "function") {
+                throw whyr_exception(("malformed manifest '" + path + "'").c_str());
+            }
+            header.get();
+            getline(header, name);
+            
+            Entry &entry = previous[name];
+            entry.fingerprint = fingerprint;
+            for (unsigned i = 0; i < count && getline(file, line); i++) {
+                entry.results.push_back(line);
+            }
+        }
+    }
+    
+    Why3Manifest::~Why3Manifest() {
+        delete slots;
+    }
+    
+    string Why3Manifest::getModuleFingerprint(AnnotatedModule* module) {
+        if (!moduleFingerprint.empty()) {
+            return moduleFingerprint;
+        }
+        
+        // metadata numbers are stripped anyway, so there is no need to number all of it up front
+        slots = new ModuleSlotTracker(module->rawIR(), false);
+        
+        MD5 hash;
+        hash.update(module->rawIR()->getDataLayoutStr());
+        for (Module::global_iterator ii = module->rawIR()->global_begin(); ii != module->rawIR()->global_end(); ii++) {
+            hash.update(getIRText(&*ii, *slots));
+        }
+        
+        // an instruction names the struct types it uses, but their fields are only written out here; sort them so the order is stable
+        set<string> structs;
+        TypeInfo* info = module->getTypeInfo();
+        for (unordered_set<StructType*>::iterator ii = info->structTypes.begin(); ii != info->structTypes.end(); ii++) {
+            string text;
+            raw_string_ostream stream(text);
+            stream << (*ii)->getName() << " = ";
+            (*ii)->print(stream);
+            structs.insert(stream.str());
+        }
+        for (set<string>::iterator ii = structs.begin(); ii != structs.end(); ii++) {
+            hash.update(*ii);
+        }
+        
+        moduleFingerprint = getHash(hash);
+        return moduleFingerprint;
+    }
+    
+    string Why3Manifest::getFingerprint(AnnotatedFunction* func) {
+        unordered_map<AnnotatedFunction*, string>::iterator found = fingerprints.find(func);
+        if (found != fingerprints.end()) {
+            return found->second;
+        }
+        // recursive functions see themselves as having no fingerprint; they are never generated anyway
+        fingerprints[func] = "";
+        
+        MD5 hash;
+        hash.update(context);
+        hash.update(getModuleFingerprint(func->getModule()));
+        
+        // the function's IR, without debug info, which changes whenever a line is added above it
+        Function* raw = func->rawIR();
+        hash.update(raw->getName());
+        hash.update(getIRText(raw->getFunctionType()));
+        for (Function::iterator ii = raw->begin(); ii != raw->end(); ii++) {
+            hash.update(ii->getName());
+            for (BasicBlock::iterator jj = ii->begin(); jj != ii->end(); jj++) {
+                if (!isa<DbgInfoIntrinsic>(&*jj)) {
+                    hash.update(getIRText(&*jj, *slots));
+                }
+            }
+        }
+        
+        // the function's annotations
+        if (func->getRequiresClause()) {
+            hash.update("requires " + stripMetadataNumbers(func->getRequiresClause()->toString()));
+        }
+        if (func->getEnsuresClause()) {
+            hash.update("ensures " + stripMetadataNumbers(func->getEnsuresClause()->toString()));
+        }
+        if (func->getAssignsLocations()) {
+            for (list<LogicExpression*>::iterator ii = func->getAssignsLocations()->begin(); ii != func->getAssignsLocations()->end(); ii++) {
+                hash.update("assigns " + stripMetadataNumbers((*ii)->toString()));
+            }
+        }
+        for (list<AnnotatedInstruction*>::iterator ii = func->getAnnotatedInstructions()->begin(); ii != func->getAnnotatedInstructions()->end(); ii++) {
+            hash.update(getIRText((*ii)->rawIR(), *slots));
+            if ((*ii)->getAssumeClause()) {
+                hash.update("assume " + stripMetadataNumbers((*ii)->getAssumeClause()->toString()));
+            }
+            if ((*ii)->getAssertClause()) {
+                hash.update("assert " + stripMetadataNumbers((*ii)->getAssertClause()->toString()));
+            }
+        }
+        
+        // every function it calls, sorted by name so the order is stable
+        map<string, string> callees;
+        unordered_set<Function*>* called = &func->getTypeInfo()->funcsCalled;
+        for (unordered_set<Function*>::iterator ii = called->begin(); ii != called->end(); ii++) {
+            AnnotatedFunction* callee = func->getModule()->getFunction(*ii);
+            if (callee && callee != func) {
+                callees[(*ii)->getName().str()] = getFingerprint(callee);
+            }
+        }
+        for (map<string, string>::iterator ii = callees.begin(); ii != callees.end(); ii++) {
+            hash.update(ii->first + " " + ii->second);
+        }
+        
+        string result = getHash(hash);
+        fingerprints[func] = result;
+        return result;
+    }
+    
+    bool Why3Manifest::checkFunction(AnnotatedFunction* func, FunctionGoals &goals) {
+        string name = func->rawIR()->getName().str();
+        string fingerprint = getFingerprint(func);
+        seen.insert(name);
+        
+        unordered_map<string, Entry>::iterator old = previous.find(name);
+        if (!fingerprint.empty() && old != previous.end() && old->second.fingerprint == fingerprint) {
+            // rename the saved results after the goals as they are numbered now
+            vector<string> theoryNames(goals.sites.size() + 1);
+            for (list<GoalSite>::iterator ii = goals.sites.begin(); ii != goals.sites.end(); ii++) {
+                theoryNames[ii->id] = ii->theoryName;
+            }
+            
+            bool valid = true;
+            ostringstream results;
+            for (list<string>::iterator ii = old->second.results.begin(); ii != old->second.results.end(); ii++) {
+                istringstream line(*ii);
+                unsigned id;
+                string suffix, colon, result;
+                if (!(line >> id >> suffix >> colon) || id == 0 || id >= theoryNames.size()) {
+                    valid = false;
+                    break;
+                }
+                line.get();
+                getline(line, result);
+                results << "manifest " << theoryNames[id] << " " << theoryNames[id] << (suffix == "-" ? "" : suffix) << " : " << result << endl;
+            }
+            
+            if (valid) {
+                reused << results.str();
+                current[name] = old->second;
+                return true;
+            }
+        }
+        
+        pending[name] = goals.sites.size();
+        current[name].fingerprint = fingerprint;
+        for (list<GoalSite>::iterator ii = goals.sites.begin(); ii != goals.sites.end(); ii++) {
+            goalSites[ii->theoryName] = make_pair(name, ii->id);
+        }
+        return false;
+    }
+    
+    void Why3Manifest::addResults(Why3Output &results) {
+        if (results.error) {
+            return;
+        }
+        
+        unordered_map<string, set<unsigned>> proven;
+        for (list<Why3Goal>::iterator ii = results.goals.begin(); ii != results.goals.end(); ii++) {
+            if (!ii->theory || !ii->goal) continue;
+            unordered_map<string, pair<string, unsigned>>::iterator site = goalSites.find(ii->theory);
+            if (site == goalSites.end()) continue;
+            
+            string goal(ii->goal);
+            string suffix = goal.compare(0, site->first.size(), site->first) == 0 ? goal.substr(site->first.size()) : "";
+            ostringstream line;
+            line << site->second.second << " " << (suffix.empty() ? "-" : suffix) << " : ";
+            writeWhy3GoalResult(line, *ii);
+            
+            current[site->second.first].results.push_back(line.str());
+            proven[site->second.first].insert(site->second.second);
+        }
+        
+        // a function missing some of its results has to be proven again next time
+        for (unordered_map<string, unsigned>::iterator ii = pending.begin(); ii != pending.end(); ii++) {
+            if (proven[ii->first].size() != ii->second) {
+                current.erase(ii->first);
+            }
+        }
+        pending.clear();
+    }
+    
+    void Why3Manifest::getReusedResults(Why3Output &out) {
+        Why3Output results(reused.str().c_str());
+        for (list<Why3Goal>::iterator ii = results.goals.begin(); ii != results.goals.end(); ii++) {
+            ii->cached = true;
+        }
+        out.merge(results);
+    }
+    
+    void Why3Manifest::save() {
+        // write to a temporary file first, so an interrupted run leaves the old manifest intact
+        string tempPath = path + ".tmp." + to_string(getpid());
+        {
+            ofstream file(tempPath);
+            file << MANIFEST_HEADER << endl;
+            file << "context " << context << endl;
+            
+            // sort by name, so the file is stable from run to run
+            map<string, Entry*> sorted;
+            for (unordered_map<string, Entry>::iterator ii = current.begin(); ii != current.end(); ii++) {
+                sorted[ii->first] = &ii->second;
+            }
+            // functions left out of this run, such as by a function filter, keep what was saved for them
+            for (unordered_map<string, Entry>::iterator ii = previous.begin(); ii != previous.end(); ii++) {
+                if (!seen.count(ii->first)) {
+                    sorted[ii->first] = &ii->second;
+                }
+            }
+            for (map<string, Entry*>::iterator ii = sorted.begin(); ii != sorted.end(); ii++) {
+                file << "function " << ii->second->fingerprint << " " << ii->second->results.size() << " " << ii->first << endl;
+                for (list<string>::iterator jj = ii->second->results.begin(); jj != ii->second->results.end(); jj++) {
+                    file << *jj << endl;
+                }
+            }
+            
+            if (!file) {
+                remove(tempPath.c_str());
+                throw whyr_exception(("could not write manifest '" + path + "'").c_str());
+            }
+        }
+        if (rename(tempPath.c_str(), path.c_str())) {
+            remove(tempPath.c_str());
+            throw whyr_exception(("could not write manifest '" + path + "'").c_str());
+        }
+    }
+}
@@ -6,6 +6,10 @@
  */
 
 #include <whyr/module.hpp>
+#include <whyr/esc_why3.hpp>
+#include <whyr/exception.hpp>
+
+#include <llvm/Support/Regex.h>
 
 namespace whyr {
     using namespace std;
@@ -13,25 +17,196 @@ namespace whyr {
     
     AnnotatedModule::AnnotatedModule(unique_ptr<Module>& llvm, WhyRSettings* settings) : settings{settings} {
         this->llvm = move(llvm);
+        // made up front rather than on first use, so it is never created by two threads at once
+        names = new NameMangler();
     }
     
     AnnotatedModule::~AnnotatedModule() {
         for (list<AnnotatedFunction*>::iterator ii = functions.begin(); ii != functions.end(); ii++) {
             delete *ii;
         }
+        for (map<tuple<Metadata*, AnnotatedFunction*, bool>, LogicExpression*>::iterator ii = parsedTypes.begin(); ii != parsedTypes.end(); ii++) {
+            delete ii->second;
+        }
+        
+        delete typeInfo;
+        delete names;
         
         LLVMContext* ctx = &llvm->getContext();
         llvm.release();
         delete ctx;
     }
     
+    /**
+     * Returns true if md is a string node holding the given value.
+     */
+    static bool isMDString(Metadata* md, const char* value) {
+        return md && isa<MDString>(md) && cast<MDString>(md)->getString() == value;
+    }
+    
+    /**
+     * The functions needed by those the function filters select, found by walking what each one refers to.
+     */
+    struct FunctionSelection {
+        Module* mod;
+        /// Every function referred to, directly or indirectly, by a selected function.
+        unordered_set<Function*> needed;
+        /// The needed functions whose bodies are kept: those selected, and those whose blocks are addressed, since the theory names their blocks.
+        unordered_set<Function*> kept;
+        /// Functions needed or kept since their references were last walked.
+        list<Function*> queue;
+        /// The annotation nodes already walked.
+        unordered_set<MDNode*> visited;
+        /// The names of the module's metadata kinds, by ID, to pick out the annotations from the rest, such as debug info.
+        SmallVector<StringRef, 16> kinds;
+        
+        FunctionSelection(Module* mod) : mod{mod} {
+            mod->getMDKindNames(kinds);
+        }
+        
+        void add(Function* func, bool keep) {
+            bool added = needed.insert(func).second;
+            if (keep && kept.insert(func).second) {
+                added = true;
+            }
+            if (added) {
+                queue.push_back(func);
+            }
+        }
+        
+        bool isAnnotation(unsigned kind) {
+            return kind < kinds.size() && kinds[kind].startswith("whyr.");
+        }
+        
+        /**
+         * Adds the functions an annotation refers to: those given as constants, and those whose blocks a 'blockaddress' expression names.
+         */
+        void addAnnotation(Metadata* md) {
+            if (ConstantAsMetadata* constant = dyn_cast<ConstantAsMetadata>(md)) {
+                if (BlockAddress* baddr = dyn_cast<BlockAddress>(constant->getValue())) {
+                    add(baddr->getFunction(), true);
+                } else if (Function* func = dyn_cast<Function>(constant->getValue()->stripPointerCasts())) {
+                    add(func, false);
+                }
+            } else if (MDNode* node = dyn_cast<MDNode>(md)) {
+                if (!visited.insert(node).second) {
+                    return;
+                }
+                if (node->getNumOperands() == 3 && isMDString(node->getOperand(0).get(), "blockaddress") && node->getOperand(1) && isa<MDString>(node->getOperand(1).get())) {
+                    Function* func = mod->getFunction(cast<MDString>(node->getOperand(1).get())->getString());
+                    if (func) {
+                        add(func, true);
+                    }
+                }
+                for (unsigned i = 0; i < node->getNumOperands(); i++) {
+                    if (node->getOperand(i)) {
+                        addAnnotation(node->getOperand(i).get());
+                    }
+                }
+            }
+        }
+        
+        void addAnnotations(SmallVector<pair<unsigned, MDNode*>, 4> &attached) {
+            for (SmallVector<pair<unsigned, MDNode*>, 4>::iterator ii = attached.begin(); ii != attached.end(); ii++) {
+                if (isAnnotation(ii->first)) {
+                    addAnnotation(ii->second);
+                }
+            }
+        }
+        
+        /**
+         * Adds everything a function refers to from its contract, and if its body is kept, from its body and the annotations in it.
+         */
+        void walk(Function* func) {
+            SmallVector<pair<unsigned, MDNode*>, 4> contract;
+            func->getAllMetadata(contract);
+            addAnnotations(contract);
+            
+            if (!kept.count(func)) {
+                return;
+            }
+            for (Function::iterator ii = func->begin(); ii != func->end(); ii++) {
+                for (BasicBlock::iterator jj = ii->begin(); jj != ii->end(); jj++) {
+                    for (User::op_iterator op = jj->op_begin(); op != jj->op_end(); op++) {
+                        if (BlockAddress* baddr = dyn_cast<BlockAddress>(*op)) {
+                            add(baddr->getFunction(), true);
+                        } else if (Function* callee = dyn_cast<Function>((*op)->stripPointerCasts())) {
+                            add(callee, false);
+                        }
+                    }
+                    
+                    SmallVector<pair<unsigned, MDNode*>, 4> annotations;
+                    jj->getAllMetadata(annotations);
+                    addAnnotations(annotations);
+                }
+            }
+        }
+    };
+    
+    /**
+     * Finds the functions selected by the function filters in settings, and every function they refer to.
+     * The bodies of functions referred to but not selected are deleted, so only their contracts are emitted,
+     * unless their blocks are addressed, in which case they are kept, but still have no goals of their own.
+     */
+    static void selectFunctions(Module* mod, WhyRSettings* settings, unordered_set<Function*> &needed, unordered_set<Function*> &selected) {
+        // each filter has to match the whole name
+        list<Regex> filters;
+        for (list<string>::iterator ii = settings->functionFilters.begin(); ii != settings->functionFilters.end(); ii++) {
+            filters.push_back(Regex("^(" + *ii + ")$"));
+            string error;
+            if (!filters.back().isValid(error)) {
+                throw whyr_exception(("invalid function filter '" + *ii + "': " + error).c_str());
+            }
+        }
+        
+        FunctionSelection selection(mod);
+        for (Module::iterator ii = mod->begin(); ii != mod->end(); ii++) {
+            for (list<Regex>::iterator jj = filters.begin(); jj != filters.end(); jj++) {
+                if (jj->match(ii->getName())) {
+                    selected.insert(&*ii);
+                    selection.add(&*ii, true);
+                    break;
+                }
+            }
+        }
+        
+        // a kept function's references are needed too, so keep walking until nothing new turns up
+        while (!selection.queue.empty()) {
+            Function* func = selection.queue.front();
+            selection.queue.pop_front();
+            selection.walk(func);
+        }
+        needed = selection.needed;
+        
+        for (unordered_set<Function*>::iterator ii = needed.begin(); ii != needed.end(); ii++) {
+            if (!selection.kept.count(*ii) && !(*ii)->isDeclaration()) {
+                // deleting the body clears the function's metadata, which holds its contract, so put it back
+                SmallVector<pair<unsigned, MDNode*>, 4> contract;
+                (*ii)->getAllMetadata(contract);
+                (*ii)->deleteBody();
+                for (SmallVector<pair<unsigned, MDNode*>, 4>::iterator jj = contract.begin(); jj != contract.end(); jj++) {
+                    (*ii)->setMetadata(jj->first, jj->second);
+                }
+            }
+        }
+    }
+    
     void AnnotatedModule::annotate() {
-        // annotate all functions
+        bool filtered = settings && !settings->functionFilters.empty();
+        unordered_set<Function*> needed;
+        if (filtered) {
+            selectFunctions(&*llvm, settings, needed, selected);
+        }
+        
+        // annotate all functions, or only the ones needed by the filters
         for (Module::iterator ii = llvm->begin(); ii != llvm->end(); ii++) {
+            if (filtered && !needed.count(&*ii)) continue;
             AnnotatedFunction* f = new AnnotatedFunction(this, &*ii);
             f->annotate();
             functions.push_back(f);
         }
+        
+        invalidateTypeInfo();
     }
     
     list<AnnotatedFunction*>* AnnotatedModule::getFunctions() {
@@ -43,27 +218,74 @@ namespace whyr {
         return &(*llvm);
     }
     
+    void AnnotatedModule::indexFunctions() {
+        if (functions.size() == functionsIndexed) {
+            // already up to date; return without writing anything, so lookups are safe from several threads at once
+            return;
+        } else if (functions.size() < functionsIndexed) {
+            // functions were removed; start over
+            functionsIndex.clear();
+            functionNamesIndex.clear();
+            functionsIndexed = 0;
+        }
+        
+        // index only the functions added since last time, which are at the end of the list
+        list<AnnotatedFunction*>::iterator ii = functions.end();
+        for (size_t i = functionsIndexed; i < functions.size(); i++) {
+            ii--;
+        }
+        for (; ii != functions.end(); ii++) {
+            functionsIndex.insert(make_pair((*ii)->rawIR(), *ii));
+            // the first function with a given name wins, as it did when this was a linear search
+            functionNamesIndex.insert(make_pair((*ii)->rawIR()->getName().str(), *ii));
+        }
+        functionsIndexed = functions.size();
+    }
+    
     AnnotatedFunction* AnnotatedModule::getFunction(const char* name) {
-        for (list<AnnotatedFunction*>::iterator ii = functions.begin(); ii != functions.end(); ii++) {
-            AnnotatedFunction* f = *ii;
-            if (f->rawIR()->getName().compare(StringRef(name)) == 0) {
-                return f;
-            }
+        indexFunctions();
+        unordered_map<string, AnnotatedFunction*>::iterator found = functionNamesIndex.find(string(name));
+        if (found == functionNamesIndex.end()) {
+            return NULL;
         }
-        return NULL;
+        return found->second;
     }
     
     AnnotatedFunction* AnnotatedModule::getFunction(Function* func) {
-        for (list<AnnotatedFunction*>::iterator ii = functions.begin(); ii != functions.end(); ii++) {
-            AnnotatedFunction* f = *ii;
-            if (f->rawIR() == func) {
-                return f;
-            }
+        indexFunctions();
+        unordered_map<Function*, AnnotatedFunction*>::iterator found = functionsIndex.find(func);
+        if (found == functionsIndex.end()) {
+            return NULL;
         }
-        return NULL;
+        return found->second;
     }
     
     WhyRSettings* AnnotatedModule::getSettings() {
         return settings;
     }
+    
+    bool AnnotatedModule::isSelected(Function* func) {
+        return !settings || settings->functionFilters.empty() || selected.count(func);
+    }
+    
+    TypeInfo* AnnotatedModule::getTypeInfo() {
+        if (!typeInfo) {
+            typeInfo = new TypeInfo();
+            computeTypeInfo(*typeInfo, this);
+        }
+        return typeInfo;
+    }
+    
+    void AnnotatedModule::invalidateTypeInfo() {
+        delete typeInfo;
+        typeInfo = NULL;
+    }
+    
+    NameMangler* AnnotatedModule::getNameMangler() {
+        return names;
+    }
+    
+    map<tuple<Metadata*, AnnotatedFunction*, bool>, LogicExpression*>* AnnotatedModule::getParsedTypes() {
+        return &parsedTypes;
+    }
 }
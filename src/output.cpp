@@ -0,0 +1,267 @@
+/*
+ * output.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include <whyr/output.hpp>
+
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+
+namespace whyr {
+    using namespace std;
+    using namespace llvm;
+    
+    FdStreamBuf::FdStreamBuf(int fd, bool ownsFd, size_t bufferSize) : fd{fd}, ownsFd{ownsFd}, buffer(bufferSize) {
+        setp(buffer.data(), buffer.data() + buffer.size());
+    }
+    
+    FdStreamBuf::~FdStreamBuf() {
+        close();
+    }
+    
+    bool FdStreamBuf::flushBuffer() {
+        char* data = pbase();
+        size_t left = pptr() - pbase();
+        
+        while (left > 0) {
+            ssize_t n = write(fd, data, left);
+            if (n == -1) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            data += n;
+            left -= n;
+        }
+        
+        setp(buffer.data(), buffer.data() + buffer.size());
+        return true;
+    }
+    
+    FdStreamBuf::int_type FdStreamBuf::overflow(int_type c) {
+        if (fd == -1 || !flushBuffer()) {
+            return traits_type::eof();
+        }
+        
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+    
+    int FdStreamBuf::sync() {
+        if (fd == -1 || !flushBuffer()) {
+            return -1;
+        }
+        return 0;
+    }
+    
+    int FdStreamBuf::getFd() {
+        return fd;
+    }
+    
+    void FdStreamBuf::close() {
+        if (fd == -1) return;
+        
+        flushBuffer();
+        if (ownsFd) {
+            ::close(fd);
+        }
+        fd = -1;
+        // anything written after this point overflows, and fails
+        setp(NULL, NULL);
+    }
+    
+    DuplexStreamBuf::DuplexStreamBuf(int writeFd, int readFd, streambuf* sink, size_t bufferSize) : FdStreamBuf(writeFd, true, bufferSize), readFd{readFd}, sink{sink}, readBuffer(bufferSize) {
+        // writes must never block, or we couldn't read output while the process's input is full
+        fcntl(writeFd, F_SETFL, fcntl(writeFd, F_GETFL) | O_NONBLOCK);
+    }
+    
+    DuplexStreamBuf::~DuplexStreamBuf() {
+        // the base class destructor can't call our flushBuffer, so close here
+        close();
+        if (readFd != -1) {
+            ::close(readFd);
+        }
+    }
+    
+    void DuplexStreamBuf::setSink(streambuf* sink) {
+        this->sink = sink;
+    }
+    
+    bool DuplexStreamBuf::poll(bool wantWrite, bool &canWrite, int timeout) {
+        pollfd fds[2];
+        nfds_t nfds = 0;
+        if (readFd != -1) {
+            fds[nfds].fd = readFd;
+            fds[nfds].events = POLLIN;
+            nfds++;
+        }
+        if (wantWrite) {
+            fds[nfds].fd = fd;
+            fds[nfds].events = POLLOUT;
+            nfds++;
+        }
+        
+        canWrite = false;
+        if (nfds == 0) {
+            return true;
+        }
+        int ready = ::poll(fds, nfds, timeout);
+        if (ready == -1) {
+            return errno == EINTR;
+        }
+        idle = (ready == 0);
+        
+        for (nfds_t i = 0; i < nfds; i++) {
+            if (fds[i].fd == readFd && (fds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+                ssize_t n = read(readFd, readBuffer.data(), readBuffer.size());
+                if (n == -1) {
+                    if (errno != EINTR) return false;
+                } else if (n == 0) {
+                    ::close(readFd);
+                    readFd = -1;
+                } else {
+                    sawOutput = true;
+                    if (sink) {
+                        sink->sputn(readBuffer.data(), n);
+                    }
+                }
+            } else if (fds[i].fd == fd && (fds[i].revents & (POLLOUT | POLLHUP | POLLERR))) {
+                canWrite = true;
+            }
+        }
+        return true;
+    }
+    
+    bool DuplexStreamBuf::flushBuffer() {
+        char* data = pbase();
+        size_t left = pptr() - pbase();
+        
+        while (left > 0) {
+            bool canWrite;
+            if (!poll(true, canWrite)) {
+                return false;
+            }
+            if (!canWrite) continue;
+            
+            ssize_t n = write(fd, data, left);
+            if (n == -1) {
+                if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) continue;
+                return false;
+            }
+            data += n;
+            left -= n;
+            written += n;
+        }
+        
+        setp(buffer.data(), buffer.data() + buffer.size());
+        return true;
+    }
+    
+    bool DuplexStreamBuf::readAll(int idleTimeout, int firstTimeout) {
+        idle = false;
+        while (readFd != -1) {
+            bool canWrite;
+            if (!poll(false, canWrite, (sawOutput || firstTimeout < 0) ? idleTimeout : firstTimeout) || idle) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    size_t DuplexStreamBuf::getBytesWritten() {
+        return written;
+    }
+    
+    bool DuplexStreamBuf::timedOut() {
+        return idle;
+    }
+    
+    TeeStreamBuf::TeeStreamBuf(streambuf* first, streambuf* second) : first{first}, second{second} {}
+    
+    TeeStreamBuf::int_type TeeStreamBuf::overflow(int_type c) {
+        if (traits_type::eq_int_type(c, traits_type::eof())) {
+            return traits_type::not_eof(c);
+        }
+        
+        int_type r1 = first->sputc(traits_type::to_char_type(c));
+        int_type r2 = second->sputc(traits_type::to_char_type(c));
+        if (traits_type::eq_int_type(r1, traits_type::eof()) || traits_type::eq_int_type(r2, traits_type::eof())) {
+            return traits_type::eof();
+        }
+        return c;
+    }
+    
+    streamsize TeeStreamBuf::xsputn(const char* s, streamsize n) {
+        streamsize n1 = first->sputn(s, n);
+        streamsize n2 = second->sputn(s, n);
+        return min(n1, n2);
+    }
+    
+    int TeeStreamBuf::sync() {
+        int r1 = first->pubsync();
+        int r2 = second->pubsync();
+        return (r1 == 0 && r2 == 0) ? 0 : -1;
+    }
+    
+    TheorySizeStreamBuf::int_type TheorySizeStreamBuf::overflow(int_type c) {
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            char ch = traits_type::to_char_type(c);
+            xsputn(&ch, 1);
+        }
+        return traits_type::not_eof(c);
+    }
+    
+    streamsize TheorySizeStreamBuf::xsputn(const char* s, streamsize n) {
+        static const string header("theory ");
+        
+        for (streamsize i = 0; i < n; i++) {
+            if (s[i] != '\n') {
+                // only a theory header is kept whole, since its name is needed
+                if (line.size() < header.size() || line.compare(0, header.size(), header) == 0) {
+                    line += s[i];
+                }
+                lineLength++;
+                continue;
+            }
+            
+            // lines are counted once they end, newline included
+            if (line.compare(0, header.size(), header) == 0) {
+                string name = line.substr(header.size(), line.find(' ', header.size()) - header.size());
+                current = &sizes[name];
+                *current = lineLength + 1;
+            } else if (current) {
+                *current += lineLength + 1;
+                if (line == "end" && lineLength == 3) {
+                    current = NULL;
+                }
+            }
+            line.clear();
+            lineLength = 0;
+        }
+        return n;
+    }
+    
+    size_t TheorySizeStreamBuf::getSize(const string &theory) const {
+        unordered_map<string, size_t>::const_iterator ii = sizes.find(theory);
+        return ii == sizes.end() ? 0 : ii->second;
+    }
+    
+    FdOstream::FdOstream(int fd, bool ownsFd, size_t bufferSize) : ostream(NULL), buf(fd, ownsFd, bufferSize) {
+        rdbuf(&buf);
+    }
+    
+    int FdOstream::getFd() {
+        return buf.getFd();
+    }
+    
+    void FdOstream::close() {
+        flush();
+        buf.close();
+    }
+}
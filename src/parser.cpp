@@ -118,6 +118,32 @@ namespace whyr {
         }
     }
     
+    LogicExpression* ExpressionParser::parseTypeMetadata(Metadata* node, NodeSource* source) {
+        // a logic-local can be shadowed, or freed along with its quantifier, so nodes in its scope are never shared
+        bool inLocalScope = false;
+        for (unordered_map<string, list<LogicLocal*>>::iterator ii = source->logicLocals.begin(); ii != source->logicLocals.end(); ii++) {
+            if (!ii->second.empty()) {
+                inLocalScope = true;
+                break;
+            }
+        }
+        if (inLocalScope || !source->shareTypes || !source->func) {
+            return parseMetadata(node, source);
+        }
+        
+        // 'arg' depends on the function, and 'result' and 'var' on whether we are in a contract, but nothing depends on the instruction
+        map<tuple<Metadata*, AnnotatedFunction*, bool>, LogicExpression*>* parsed = source->func->getModule()->getParsedTypes();
+        tuple<Metadata*, AnnotatedFunction*, bool> key(node, source->func, source->inst == NULL);
+        map<tuple<Metadata*, AnnotatedFunction*, bool>, LogicExpression*>::iterator found = parsed->find(key);
+        if (found != parsed->end()) {
+            return found->second;
+        }
+        
+        LogicExpression* expr = parseMetadata(node, source);
+        parsed->insert(make_pair(key, expr));
+        return expr;
+    }
+    
     ExpressionParser::ExpressionParser() {}
     ExpressionParser::~ExpressionParser() {}
     
@@ -144,7 +170,10 @@ namespace whyr {
     class ParserSet : public ExpressionParser {
         LogicExpression* parse(const char* exprName, MDNode* node, NodeSource* source) {
             requireMinArgs(node, exprName, source, 1);
-            LogicExpression* baseTypeExpr = ExpressionParser::parseMetadata(node->getOperand(1).get(), source);
+            // the set frees its type, so nothing it is made from may be shared
+            NodeSource* typeSource = new NodeSource(source);
+            typeSource->shareTypes = false;
+            LogicExpression* baseTypeExpr = ExpressionParser::parseMetadata(node->getOperand(1).get(), typeSource);
             if (!isa<LogicTypeType>(baseTypeExpr->returnType())) {
                 throw type_exception(("Argument 1 to 'set' must be of type 'type', got type '" + baseTypeExpr->returnType()->toString() + "'"), NULL, source);
             }
@@ -163,7 +192,7 @@ namespace whyr {
             requireMinArgs(node, exprName, source, 1);
             requireMaxArgs(node, exprName, source, 1);
             Metadata* exprNode = node->getOperand(1).get();
-            LogicExpression* expr = ExpressionParser::parseMetadata(exprNode, source);
+            LogicExpression* expr = ExpressionParser::parseTypeMetadata(exprNode, source);
             return new LogicExpressionConstantType(new LogicTypeType(expr->returnType(), source), source);
         }
     };
@@ -337,7 +366,7 @@ namespace whyr {
                 }
                 string name = string(cast<MDString>(nameNodeRaw)->getString().data());
                 
-                LogicExpression* typeExpr = ExpressionParser::parseMetadata(typeNodeRaw, source);
+                LogicExpression* typeExpr = ExpressionParser::parseTypeMetadata(typeNodeRaw, source);
                 if (!isa<LogicTypeType>(typeExpr->returnType())) {
                     throw type_exception(("Element 1 of elements of argument 1 of '" + string(exprName) + "' must be of type 'type<T>', got type '" + typeExpr->returnType()->toString() + "'"), NULL, source);
                 }
@@ -407,7 +436,7 @@ namespace whyr {
                 }
                 string name = string(cast<MDString>(nameNodeRaw)->getString().data());
                 
-                LogicExpression* typeExpr = ExpressionParser::parseMetadata(typeNodeRaw, source);
+                LogicExpression* typeExpr = ExpressionParser::parseTypeMetadata(typeNodeRaw, source);
                 if (!isa<LogicTypeType>(typeExpr->returnType())) {
                     throw type_exception(("Element 1 of elements of argument 1 of '" + string(exprName) + "' must be of type 'type<T>', got type '" + typeExpr->returnType()->toString() + "'"), NULL, source);
                 }
@@ -486,7 +515,7 @@ namespace whyr {
             requireMinArgs(node, exprName, source, 2);
             requireMaxArgs(node, exprName, source, 2);
             
-            LogicExpression* baseTypeExpr = ExpressionParser::parseMetadata(node->getOperand(1).get(), source);
+            LogicExpression* baseTypeExpr = ExpressionParser::parseTypeMetadata(node->getOperand(1).get(), source);
             if (!isa<LogicTypeType>(baseTypeExpr->returnType())) {
                 throw type_exception(("Argument 1 to 'trunc' must be of type 'type', got type '" + baseTypeExpr->returnType()->toString() + "'"), NULL, source);
             }
@@ -507,7 +536,7 @@ namespace whyr {
             requireMinArgs(node, exprName, source, 2);
             requireMaxArgs(node, exprName, source, 2);
             
-            LogicExpression* baseTypeExpr = ExpressionParser::parseMetadata(node->getOperand(1).get(), source);
+            LogicExpression* baseTypeExpr = ExpressionParser::parseTypeMetadata(node->getOperand(1).get(), source);
             if (!isa<LogicTypeType>(baseTypeExpr->returnType())) {
                 throw type_exception(("Argument 1 to 'zext' must be of type 'type', got type '" + baseTypeExpr->returnType()->toString() + "'"), NULL, source);
             }
@@ -527,7 +556,7 @@ namespace whyr {
             requireMinArgs(node, exprName, source, 2);
             requireMaxArgs(node, exprName, source, 2);
             
-            LogicExpression* baseTypeExpr = ExpressionParser::parseMetadata(node->getOperand(1).get(), source);
+            LogicExpression* baseTypeExpr = ExpressionParser::parseTypeMetadata(node->getOperand(1).get(), source);
             if (!isa<LogicTypeType>(baseTypeExpr->returnType())) {
                 throw type_exception(("Argument 1 to 'sext' must be of type 'type', got type '" + baseTypeExpr->returnType()->toString() + "'"), NULL, source);
             }
@@ -561,7 +590,7 @@ namespace whyr {
             requireMinArgs(node, exprName, source, 2);
             requireMaxArgs(node, exprName, source, 2);
             
-            LogicExpression* baseTypeExpr = ExpressionParser::parseMetadata(node->getOperand(1).get(), source);
+            LogicExpression* baseTypeExpr = ExpressionParser::parseTypeMetadata(node->getOperand(1).get(), source);
             if (!isa<LogicTypeType>(baseTypeExpr->returnType())) {
                 throw type_exception(("Argument 1 to 'real.to.float' must be of type 'type', got type '" + baseTypeExpr->returnType()->toString() + "'"), NULL, source);
             }
@@ -643,7 +672,7 @@ namespace whyr {
         LogicExpression* parse(const char* exprName, MDNode* node, NodeSource* source) {
             requireMinArgs(node, exprName, source, 1);
             
-            LogicExpression* baseTypeExpr = ExpressionParser::parseMetadata(node->getOperand(1).get(), source);
+            LogicExpression* baseTypeExpr = ExpressionParser::parseTypeMetadata(node->getOperand(1).get(), source);
             if (!isa<LogicTypeType>(baseTypeExpr->returnType())) {
                 throw type_exception(("Argument 1 to 'array' must be of type 'type', got type '" + baseTypeExpr->returnType()->toString() + "'"), NULL, source);
             }
@@ -668,7 +697,7 @@ namespace whyr {
             requireMinArgs(node, exprName, source, 2);
             requireMaxArgs(node, exprName, source, 2);
             
-            LogicExpression* baseTypeExpr = ExpressionParser::parseMetadata(node->getOperand(1).get(), source);
+            LogicExpression* baseTypeExpr = ExpressionParser::parseTypeMetadata(node->getOperand(1).get(), source);
             if (!isa<LogicTypeType>(baseTypeExpr->returnType())) {
                 throw type_exception(("Argument 1 to 'ptr.to.int' must be of type 'type', got type '" + baseTypeExpr->returnType()->toString() + "'"), NULL, source);
             }
@@ -684,7 +713,7 @@ namespace whyr {
             requireMinArgs(node, exprName, source, 2);
             requireMaxArgs(node, exprName, source, 2);
             
-            LogicExpression* baseTypeExpr = ExpressionParser::parseMetadata(node->getOperand(1).get(), source);
+            LogicExpression* baseTypeExpr = ExpressionParser::parseTypeMetadata(node->getOperand(1).get(), source);
             if (!isa<LogicTypeType>(baseTypeExpr->returnType())) {
                 throw type_exception(("Argument 1 to 'int.to.ptr' must be of type 'type', got type '" + baseTypeExpr->returnType()->toString() + "'"), NULL, source);
             }
@@ -700,7 +729,7 @@ namespace whyr {
             requireMinArgs(node, exprName, source, 2);
             requireMaxArgs(node, exprName, source, 2);
             
-            LogicExpression* baseTypeExpr = ExpressionParser::parseMetadata(node->getOperand(1).get(), source);
+            LogicExpression* baseTypeExpr = ExpressionParser::parseTypeMetadata(node->getOperand(1).get(), source);
             if (!isa<LogicTypeType>(baseTypeExpr->returnType())) {
                 throw type_exception(("Argument 1 to 'ptr.to.ptr' must be of type 'type', got type '" + baseTypeExpr->returnType()->toString() + "'"), NULL, source);
             }
@@ -731,7 +760,10 @@ namespace whyr {
             requireMinArgs(node, exprName, source, 1);
             requireMaxArgs(node, exprName, source, 1);
             
-            LogicExpression* baseTypeExpr = ExpressionParser::parseMetadata(node->getOperand(1).get(), source);
+            // the constant frees its type, so nothing it is made from may be shared
+            NodeSource* typeSource = new NodeSource(source);
+            typeSource->shareTypes = false;
+            LogicExpression* baseTypeExpr = ExpressionParser::parseMetadata(node->getOperand(1).get(), typeSource);
             if (!isa<LogicTypeType>(baseTypeExpr->returnType())) {
                 throw type_exception(("Argument 1 to '"+string(exprName)+"' must be of type 'type', got type '" + baseTypeExpr->returnType()->toString() + "'"), NULL, source);
             }
@@ -785,7 +817,7 @@ namespace whyr {
         LogicExpression* parse(const char* exprName, MDNode* node, NodeSource* source) {
             requireMinArgs(node, exprName, source, 1);
             
-            LogicExpression* baseTypeExpr = ExpressionParser::parseMetadata(node->getOperand(1).get(), source);
+            LogicExpression* baseTypeExpr = ExpressionParser::parseTypeMetadata(node->getOperand(1).get(), source);
             if (!isa<LogicTypeType>(baseTypeExpr->returnType())) {
                 throw type_exception(("Argument 1 to 'struct' must be of type 'type', got type '" + baseTypeExpr->returnType()->toString() + "'"), NULL, source);
             }
@@ -805,7 +837,7 @@ namespace whyr {
         LogicExpression* parse(const char* exprName, MDNode* node, NodeSource* source) {
             requireMinArgs(node, exprName, source, 1);
             
-            LogicExpression* baseTypeExpr = ExpressionParser::parseMetadata(node->getOperand(1).get(), source);
+            LogicExpression* baseTypeExpr = ExpressionParser::parseTypeMetadata(node->getOperand(1).get(), source);
             if (!isa<LogicTypeType>(baseTypeExpr->returnType())) {
                 throw type_exception(("Argument 1 to 'vector' must be of type 'type', got type '" + baseTypeExpr->returnType()->toString() + "'"), NULL, source);
             }
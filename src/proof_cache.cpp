@@ -0,0 +1,132 @@
+/*
+ * proof_cache.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include <whyr/proof_cache.hpp>
+#include <whyr/exception.hpp>
+
+#include <llvm/Support/MD5.h>
+#include <llvm/ADT/SmallString.h>
+
+#include <sstream>
+#include <fstream>
+#include <thread>
+#include <functional>
+
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace whyr {
+    using namespace std;
+    using namespace llvm;
+    
+    /**
+     * Replaces the contents of a file in the cache.
+     * Other threads and processes may be writing the same file; each writes its own temporary file, and the last rename wins.
+     */
+    static void writeFile(const string &path, const string &contents) {
+        string tempPath = path + ".tmp." + to_string(getpid()) + "." + to_string(hash<thread::id>()(this_thread::get_id()));
+        {
+            ofstream file(tempPath);
+            file << contents;
+            if (!file) {
+                remove(tempPath.c_str());
+                return;
+            }
+        }
+        if (rename(tempPath.c_str(), path.c_str())) {
+            remove(tempPath.c_str());
+        }
+    }
+    
+    Why3ProofCache::Why3ProofCache(const string &dir, const string &prover, const Why3Limits &limits) : dir{dir} {
+        if (mkdir(dir.c_str(), 0777) && errno != EEXIST) {
+            throw whyr_exception(("could not create proof cache directory '" + dir + "'").c_str());
+        }
+        
+        ostringstream info;
+        info << "prover " << prover << endl;
+        info << "time " << limits.time << endl;
+        info << "memory " << limits.memory << endl;
+        
+        // A new version of a prover can prove (or fail) different goals, so the versions are part of the key.
+        FILE* why3 = popen("why3 --version 2>&1 </dev/null; why3 --list-provers 2>&1 </dev/null", "r");
+        if (why3) {
+            char buf[4096];
+            size_t n;
+            while ((n = fread(buf, 1, sizeof(buf), why3)) > 0) {
+                info.write(buf, n);
+            }
+            pclose(why3);
+        }
+        proverInfo = info.str();
+    }
+    
+    /**
+     * Finishes a hash, and returns it as a hex string, fit to be a file name.
+     */
+    static string getHex(MD5 &hash) {
+        MD5::MD5Result result;
+        hash.final(result);
+        SmallString<32> hex;
+        MD5::stringifyResult(result, hex);
+        return hex.str().str();
+    }
+    
+    string Why3ProofCache::getKey(const string &task) {
+        MD5 hash;
+        hash.update(proverInfo);
+        hash.update(task);
+        return getHex(hash);
+    }
+    
+    bool Why3ProofCache::lookup(const string &key, string &out) {
+        ifstream file(dir + "/" + key);
+        if (!file) {
+            return false;
+        }
+        
+        ostringstream contents;
+        contents << file.rdbuf();
+        out = contents.str();
+        return true;
+    }
+    
+    void Why3ProofCache::store(const string &key, Why3Output &result) {
+        if (result.error) {
+            return;
+        }
+        
+        // write the results in the format Why3 prints them in, so they are read back by Why3Output
+        ostringstream contents;
+        for (list<Why3Goal>::iterator ii = result.goals.begin(); ii != result.goals.end(); ii++) {
+            contents << "cache " << ii->theory << " " << ii->goal << " : ";
+            writeWhy3GoalResult(contents, *ii);
+            contents << endl;
+        }
+        
+        writeFile(dir + "/" + key, contents.str());
+    }
+    
+    string Why3ProofCache::getWinnerPath(const string &module, const string &theory, const string &goal) {
+        // the names are separated by a character none of them can contain, so different names never hash the same text
+        MD5 hash;
+        hash.update(module + '\n' + theory + '\n' + goal);
+        return dir + "/winner_" + getHex(hash);
+    }
+    
+    string Why3ProofCache::getWinner(const string &module, const string &theory, const string &goal) {
+        ifstream file(getWinnerPath(module, theory, goal));
+        string prover;
+        getline(file, prover);
+        return prover;
+    }
+    
+    void Why3ProofCache::setWinner(const string &module, const string &theory, const string &goal, const string &prover) {
+        writeFile(getWinnerPath(module, theory, goal), prover + "\n");
+    }
+}
@@ -559,6 +559,9 @@ namespace whyr {
                 addRTE(func, &*jj);
             }
         }
+        
+        // new annotated instructions may have been added without changing an existing clause
+        func->invalidateTypeInfo();
     }
     
     void addRTE(AnnotatedModule* module) {
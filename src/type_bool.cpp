@@ -31,6 +31,10 @@ namespace whyr {
         out << "bool";
     }
     
+    void LogicTypeBool::getRequirements(Why3Data &data) {
+        data.importsNeeded.insert("bool.Bool");
+    }
+    
     bool LogicTypeBool::classof(const LogicType* type) {
         return type->id == classID;
     }
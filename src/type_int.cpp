@@ -30,6 +30,8 @@ namespace whyr {
         out << "int";
     }
     
+    void LogicTypeInt::getRequirements(Why3Data &data) {}
+    
     bool LogicTypeInt::classof(const LogicType* type) {
         return type->id == classID;
     }
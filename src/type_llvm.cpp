@@ -40,6 +40,10 @@ namespace whyr {
         out << getWhy3FullName(type);
     }
     
+    void LogicTypeLLVM::getRequirements(Why3Data &data) {
+        getTypeInfo(*data.info, type);
+    }
+    
     bool LogicTypeLLVM::classof(const LogicType* type) {
         return type->id == classID;
     }
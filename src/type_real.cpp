@@ -30,6 +30,8 @@ namespace whyr {
         out << "real";
     }
     
+    void LogicTypeReal::getRequirements(Why3Data &data) {}
+    
     bool LogicTypeReal::classof(const LogicType* type) {
         return type->id == classID;
     }
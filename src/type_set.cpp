@@ -43,6 +43,14 @@ namespace whyr {
         out << ")";
     }
     
+    void LogicTypeSet::getRequirements(Why3Data &data) {
+        if (isa<LogicTypeLLVM>(type) && cast<LogicTypeLLVM>(type)->getType()->isPointerTy()) {
+            LogicTypeLLVM(cast<LogicTypeLLVM>(type)->getType()->getPointerElementType()).getRequirements(data);
+        } else {
+            type->getRequirements(data);
+        }
+    }
+    
     bool LogicTypeSet::classof(const LogicType* type) {
         return type->id == classID;
     }
@@ -12,6 +12,7 @@
 #include <whyr/war.hpp>
 
 #include <sstream>
+#include <mutex>
 
 // YACC needs these defined.
 #include <stdlib.h>
@@ -1167,12 +1168,24 @@ namespace whyr {
     using namespace std;
     using namespace llvm;
     
+    /// The parser and lexer keep their state in globals, so only one string may be parsed at a time, even by different modules.
+    static mutex warParserMutex;
+    
     LogicExpression* parseWarString(string war, NodeSource* source) {
+        lock_guard<mutex> guard(warParserMutex);
         char* buffer = strdup(war.c_str());
         yyin = fmemopen(buffer, war.size(), "r");
+        // a parse that failed may have left the lexer partway through its old input
+        yyrestart(yyin);
         
         warParserSource = new NodeSource(source);
-        yyparse();
+        try {
+            yyparse();
+        } catch (...) {
+            fclose(yyin);
+            free(buffer);
+            throw;
+        }
         
         fclose(yyin);
         free(buffer);
@@ -0,0 +1,38 @@
+/*
+ * workers.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include <whyr/workers.hpp>
+
+namespace whyr {
+    using namespace std;
+    using namespace llvm;
+    
+    WorkerPool::WorkerPool(unsigned jobs, size_t count, function<void(size_t)> work) : work{work}, count{count}, next{0} {
+        for (unsigned i = 0; i < jobs && i < count; i++) {
+            workers.push_back(thread([this]() {
+                for (size_t j = next++; j < this->count; j = next++) {
+                    this->work(j);
+                }
+            }));
+        }
+    }
+    
+    WorkerPool::~WorkerPool() {
+        join();
+    }
+    
+    void WorkerPool::stop() {
+        next = count;
+    }
+    
+    void WorkerPool::join() {
+        for (vector<thread>::iterator ii = workers.begin(); ii != workers.end(); ii++) {
+            if (ii->joinable()) {
+                ii->join();
+            }
+        }
+    }
+}
@@ -0,0 +1,391 @@
+/*
+ * test_exec_why3.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "test_common.hpp"
+
+#include <whyr/exec_why3.hpp>
+#include <whyr/exception.hpp>
+
+#include <string>
+#include <list>
+#include <vector>
+#include <sstream>
+#include <unordered_map>
+#include <algorithm>
+#include <fstream>
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/// A file with a theory without goals, a goal theory imported by another, and two more goal theories.
+static const char* SPLIT_INPUT =
+    "(* header *)\n"
+    "theory Types\n"
+    "    type t\n"
+    "end\n"
+    "\n"
+    "theory Function_f\n"
+    "    use import Types\n"
+    "    predicate execute\n"
+    "    goal Function_f: execute\n"
+    "end\n"
+    "\n"
+    "theory Goal_g_assert_1\n"
+    "    use import Types\n"
+    "    clone import Function_f as F\n"
+    "    goal Goal_g_assert_1: F.execute\n"
+    "end\n"
+    "\n"
+    "theory Goal_g_assert_2\n"
+    "    use import Types\n"
+    "    goal Goal_g_assert_2: true\n"
+    "end\n";
+
+/**
+ * Splits a file with two goal theories, and checks each task has what its goal needs and nothing more.
+ */
+TEST(ExecWhy3Tests, SplitTasks) {
+    using namespace std;
+    using namespace whyr;
+    
+    string in(SPLIT_INPUT);
+    
+    list<string> tasks;
+    splitWhy3Tasks(in, tasks);
+    ASSERT_EQ(3u, tasks.size());
+    
+    list<string>::iterator task = tasks.begin();
+    // Function_f has a goal of its own, but other theories import it
+    EXPECT_NE(string::npos, task->find("(* header *)"));
+    EXPECT_NE(string::npos, task->find("goal Function_f"));
+    EXPECT_EQ(string::npos, task->find("Goal_g_assert_1"));
+    task++;
+    EXPECT_NE(string::npos, task->find("theory Types"));
+    EXPECT_NE(string::npos, task->find("theory Function_f"));
+    EXPECT_EQ(string::npos, task->find("goal Function_f"));
+    EXPECT_NE(string::npos, task->find("goal Goal_g_assert_1"));
+    task++;
+    // Goal_g_assert_2 does not use Function_f, so it is left out
+    EXPECT_NE(string::npos, task->find("theory Types"));
+    EXPECT_EQ(string::npos, task->find("Function_f"));
+    EXPECT_EQ(string::npos, task->find("Goal_g_assert_1"));
+    EXPECT_NE(string::npos, task->find("goal Goal_g_assert_2"));
+}
+
+/**
+ * Checks the closure of a task has the theories its goals can see, and only those.
+ */
+TEST(ExecWhy3Tests, TaskClosure) {
+    using namespace std;
+    using namespace whyr;
+    
+    Why3TaskList taskList(SPLIT_INPUT);
+    ASSERT_EQ(3u, taskList.size());
+    
+    string closure = taskList.getClosure(1);
+    EXPECT_NE(string::npos, closure.find("theory Types"));
+    EXPECT_NE(string::npos, closure.find("theory Function_f"));
+    EXPECT_EQ(string::npos, closure.find("goal Function_f"));
+    EXPECT_NE(string::npos, closure.find("goal Goal_g_assert_1"));
+    
+    // Goal_g_assert_2 does not use Function_f, so changing it would not change this task's result
+    closure = taskList.getClosure(2);
+    EXPECT_NE(string::npos, closure.find("theory Types"));
+    EXPECT_EQ(string::npos, closure.find("Function_f"));
+    EXPECT_NE(string::npos, closure.find("goal Goal_g_assert_2"));
+    
+    ASSERT_EQ(1u, taskList.getGoalNames(2).size());
+    EXPECT_EQ("Goal_g_assert_2", taskList.getGoalNames(2).front());
+}
+
+/**
+ * Puts tasks together into batches, and checks each theory appears once, with goals only for the tasks in the batch.
+ */
+TEST(ExecWhy3Tests, BatchTasks) {
+    using namespace std;
+    using namespace whyr;
+    
+    Why3TaskList taskList(SPLIT_INPUT);
+    ASSERT_EQ(3u, taskList.size());
+    EXPECT_EQ("Goal_g_assert_1", taskList.getTheoryName(1));
+    
+    // a batch of one task is the task itself
+    vector<size_t> single(1, 1);
+    EXPECT_EQ(taskList.getTask(1), taskList.getBatch(single));
+    
+    vector<size_t> all;
+    all.push_back(0);
+    all.push_back(1);
+    all.push_back(2);
+    string batch = taskList.getBatch(all);
+    EXPECT_EQ(batch.find("theory Function_f"), batch.rfind("theory Function_f"));
+    EXPECT_NE(string::npos, batch.find("goal Function_f"));
+    EXPECT_NE(string::npos, batch.find("goal Goal_g_assert_1"));
+    EXPECT_NE(string::npos, batch.find("goal Goal_g_assert_2"));
+    
+    // Function_f is left in without its goal, since Goal_g_assert_1 imports it
+    vector<size_t> skipFirst;
+    skipFirst.push_back(1);
+    skipFirst.push_back(2);
+    batch = taskList.getBatch(skipFirst);
+    EXPECT_NE(string::npos, batch.find("theory Function_f"));
+    EXPECT_EQ(string::npos, batch.find("goal Function_f"));
+    EXPECT_NE(string::npos, batch.find("goal Goal_g_assert_1"));
+    EXPECT_NE(string::npos, batch.find("goal Goal_g_assert_2"));
+}
+
+/**
+ * Merges the outputs of two Why3 runs, and checks the goals come out in order.
+ */
+TEST(ExecWhy3Tests, MergeOutputs) {
+    using namespace std;
+    using namespace whyr;
+    
+    Why3Output first("file.why Goal_a Goal_a : Valid (0.01s, 12 steps)\n");
+    Why3Output second("file.why Goal_b Goal_b : Timeout (5.00s)\n");
+    
+    Why3Output merged;
+    merged.merge(first);
+    merged.merge(second);
+    
+    EXPECT_FALSE(merged.error);
+    ASSERT_EQ(2u, merged.goals.size());
+    EXPECT_TRUE(first.goals.empty());
+    EXPECT_STREQ("Goal_a", merged.goals.front().goal);
+    EXPECT_EQ(Why3Goal::STATUS_VALID, merged.goals.front().status);
+    EXPECT_EQ(12, merged.goals.front().steps);
+    EXPECT_STREQ("Goal_b", merged.goals.back().goal);
+    EXPECT_EQ(Why3Goal::STATUS_TIMEOUT, merged.goals.back().status);
+}
+
+/**
+ * Feeds the outputs of two provers racing on the same batch through a portfolio, and checks which result and prover it keeps for each goal.
+ */
+TEST(ExecWhy3Tests, PortfolioResults) {
+    using namespace std;
+    using namespace whyr;
+    
+    vector<pair<string, string> > goals;
+    goals.push_back(make_pair("Goal_f", "Goal_f_assert_1"));
+    goals.push_back(make_pair("Goal_f", "Goal_f_assert_2"));
+    goals.push_back(make_pair("Goal_f", "Goal_f_assert_3"));
+    goals.push_back(make_pair("Goal_f", "Goal_f_assert_4"));
+    Why3PortfolioResults best(goals);
+    
+    // 1: a proof beats a timeout; 2: a disproof beats unknown; 3: the first of two proofs is kept; 4: unknown beats a timeout
+    // the goal of another theory is not in the batch, so it is ignored
+    string first =
+        "f.why Goal_f Goal_f_assert_1 : Timeout (5.00s)\n"
+        "f.why Goal_f Goal_f_assert_2 : Unknown (unknown) (0.50s)\n"
+        "f.why Goal_f Goal_f_assert_3 : Valid (0.10s, 12 steps)\n"
+        "f.why Goal_f Goal_f_assert_4 : Timeout (5.00s)\n";
+    string second =
+        "f.why Goal_f Goal_f_assert_1 : Valid (1.00s)\n"
+        "f.why Goal_f Goal_f_assert_2 : Failure (0.20s)\n"
+        "f.why Goal_f Goal_f_assert_3 : Valid (0.05s)\n"
+        "f.why Goal_f Goal_f_assert_4 : Unknown (unknown) (0.30s)\n"
+        "f.why Goal_g Goal_f_assert_1 : Failure (0.01s)\n";
+    
+    Why3OutputParser firstParser([&](const Why3GoalRef &goal) { best.add(goal, PROVER_ALT_ERGO); });
+    firstParser.feed(first.data(), first.size());
+    firstParser.finish();
+    EXPECT_FALSE(best.isDecided());
+    Why3OutputParser secondParser([&](const Why3GoalRef &goal) { best.add(goal, PROVER_Z3); });
+    secondParser.feed(second.data(), second.size());
+    secondParser.finish();
+    EXPECT_FALSE(best.isDecided());
+    
+    ostringstream merged;
+    unordered_map<string, string> winners;
+    EXPECT_TRUE(best.write(merged, winners));
+    Why3Output out(merged.str().c_str());
+    ASSERT_FALSE(out.error);
+    ASSERT_EQ(4u, out.goals.size());
+    
+    list<Why3Goal>::iterator goal = out.goals.begin();
+    EXPECT_STREQ("Goal_f_assert_1", goal->goal);
+    EXPECT_EQ(Why3Goal::STATUS_VALID, goal->status);
+    EXPECT_EQ(PROVER_Z3, winners["Goal_f_assert_1"]);
+    goal++;
+    EXPECT_EQ(Why3Goal::STATUS_FAIL, goal->status);
+    EXPECT_EQ(PROVER_Z3, winners["Goal_f_assert_2"]);
+    goal++;
+    EXPECT_EQ(Why3Goal::STATUS_VALID, goal->status);
+    EXPECT_EQ(12, goal->steps);
+    EXPECT_EQ(PROVER_ALT_ERGO, winners["Goal_f_assert_3"]);
+    goal++;
+    EXPECT_EQ(Why3Goal::STATUS_UNKNOWN, goal->status);
+    EXPECT_EQ(PROVER_Z3, winners["Goal_f_assert_4"]);
+    
+    // once every goal is proven or disproven, the race is decided
+    string third = "f.why Goal_f Goal_f_assert_4 : Valid (0.01s)\n";
+    Why3OutputParser thirdParser([&](const Why3GoalRef &goal) { best.add(goal, PROVER_CVC4); });
+    thirdParser.feed(third.data(), third.size());
+    thirdParser.finish();
+    EXPECT_TRUE(best.isDecided());
+    
+    // a goal nobody gave a result for leaves the merge incomplete
+    Why3PortfolioResults empty(goals);
+    ostringstream none;
+    EXPECT_FALSE(empty.write(none, winners));
+}
+
+/**
+ * Feeds Why3 output to a parser a few bytes at a time, and checks each goal is reported as soon as its line is complete.
+ */
+TEST(ExecWhy3Tests, StreamingParser) {
+    using namespace std;
+    using namespace whyr;
+    
+    string output =
+        "File \"f.why\", line 3, characters 4-9:\n"
+        "warning: unused variable\n"
+        "f.why Goal_a Goal_a : Valid (0.01s, 12 steps)\n"
+        "f.why Goal_b Goal_b : Timeout (5.00s)\n"
+        "f.why Goal_c Goal_c : Unknown (unknown) (0.50s)";
+    
+    list<string> names;
+    list<int> steps;
+    Why3OutputParser parser([&](const Why3GoalRef &goal) {
+        names.push_back(goal.goal.str());
+        steps.push_back(goal.steps);
+    });
+    
+    size_t firstGoal = output.find("Goal_a :");
+    parser.feed(output.data(), firstGoal);
+    EXPECT_TRUE(names.empty());
+    for (size_t i = firstGoal; i < output.size(); i += 5) {
+        parser.feed(output.data() + i, min((size_t) 5, output.size() - i));
+    }
+    // the last line has no newline, so it waits for finish
+    EXPECT_EQ(2u, names.size());
+    parser.finish();
+    
+    EXPECT_FALSE(parser.error);
+    ASSERT_EQ(3u, names.size());
+    EXPECT_EQ("Goal_a", names.front());
+    EXPECT_EQ(12, steps.front());
+    EXPECT_EQ("Goal_c", names.back());
+    EXPECT_EQ(-1, steps.back());
+    
+    Why3Output error("File \"f.why\", line 7, characters 2-5:\nsyntax error\nf.why Goal_a Goal_a : Valid (0.01s)\n");
+    EXPECT_TRUE(error.error);
+    EXPECT_STREQ("syntax error", error.message);
+    EXPECT_EQ(7, error.line);
+    EXPECT_EQ(2, error.colBegin);
+    EXPECT_EQ(5, error.colEnd);
+    EXPECT_TRUE(error.goals.empty());
+}
+
+/**
+ * Puts a shell script in place of why3, in a directory of its own at the front of PATH. An empty script leaves no why3 at all.
+ */
+static void setFakeWhy3(const std::string &dir, const char* script) {
+    using namespace std;
+    
+    mkdir(dir.c_str(), 0700);
+    string path = dir + "/why3";
+    remove(path.c_str());
+    if (*script) {
+        ofstream file(path);
+        file << "#!/bin/sh\n" << script << "\n";
+        file.close();
+        chmod(path.c_str(), 0700);
+    }
+}
+
+/**
+ * Runs a why3 that cannot be run, that dies, or that fails without saying why, and checks finish reports them instead of returning empty output.
+ */
+TEST(ExecWhy3Tests, FailedProcesses) {
+    using namespace std;
+    using namespace whyr;
+    
+    string dir = "/tmp/whyr_test_why3_" + to_string(getpid());
+    const char* oldPath = getenv("PATH");
+    string savedPath = oldPath ? oldPath : "";
+    
+    // with nothing else on the path, there is no why3 to run
+    ostringstream out;
+    setFakeWhy3(dir, "");
+    setenv("PATH", dir.c_str(), 1);
+    {
+        Why3Process missing;
+        EXPECT_THROW(missing.finish(out), whyr_exception);
+    }
+    setenv("PATH", (dir + ":" + savedPath).c_str(), 1);
+    
+    setFakeWhy3(dir, "kill -SEGV $$");
+    {
+        Why3Process crashed;
+        EXPECT_THROW(crashed.finish(out), whyr_exception);
+    }
+    
+    setFakeWhy3(dir, "cat > /dev/null; exit 3");
+    {
+        Why3Process failed;
+        EXPECT_THROW(failed.finish(out), whyr_exception);
+    }
+    
+    // a cancelled why3 is killed too, but that was asked for
+    setFakeWhy3(dir, "exec sleep 10");
+    {
+        Why3Process cancelled;
+        cancelled.cancel();
+        EXPECT_NO_THROW(cancelled.finish(out));
+    }
+    
+    setenv("PATH", savedPath.c_str(), 1);
+    remove((dir + "/why3").c_str());
+    rmdir(dir.c_str());
+}
+
+/**
+ * Checks every result Why3 can give a goal is understood, and that a result it can't is an error rather than a missing goal.
+ */
+TEST(ExecWhy3Tests, OtherStatuses) {
+    using namespace std;
+    using namespace whyr;
+    
+    Why3Output known("f.why Goal_a Goal_a : Invalid (0.10s)\nf.why Goal_b Goal_b : StepLimitExceeded (1.00s)\n");
+    EXPECT_FALSE(known.error);
+    ASSERT_EQ(2u, known.goals.size());
+    EXPECT_EQ(Why3Goal::STATUS_FAIL, known.goals.front().status);
+    EXPECT_EQ(Why3Goal::STATUS_TIMEOUT, known.goals.back().status);
+    
+    Why3Output unknown("f.why Goal_a Goal_a : Valid (0.10s)\nf.why Goal_b Goal_b : Bewildered (1.00s)\n");
+    EXPECT_TRUE(unknown.error);
+    EXPECT_EQ(1u, unknown.goals.size());
+}
+
+/**
+ * Checks a parser keeps the lines that are not goal results, and no more of them than it was asked to.
+ */
+TEST(ExecWhy3Tests, OtherLines) {
+    using namespace std;
+    using namespace whyr;
+    
+    string output =
+        "File \"f.why\", line 3, characters 4-9:\n"
+        "warning: unused variable\n"
+        "f.why Goal_a Goal_a : Valid (0.01s, 12 steps)\n"
+        "Prover exited with a message\n";
+    
+    Why3OutputParser parser([](const Why3GoalRef &goal) {}, 1000);
+    parser.feed(output.data(), output.size());
+    parser.finish();
+    EXPECT_EQ("File \"f.why\", line 3, characters 4-9:\nwarning: unused variable\nProver exited with a message\n", parser.otherLines);
+    EXPECT_FALSE(parser.otherLinesCut);
+    
+    Why3OutputParser small([](const Why3GoalRef &goal) {}, 30);
+    small.feed(output.data(), output.size());
+    small.finish();
+    EXPECT_EQ("warning: unused variable\n", small.otherLines);
+    EXPECT_TRUE(small.otherLinesCut);
+}
@@ -14,7 +14,10 @@
 #include <whyr/exec_why3.hpp>
 #include <whyr/rte.hpp>
 
+#include <llvm/IR/InstIterator.h>
+
 #include <list>
+#include <unordered_set>
 #include <string>
 #include <fstream>
 #include <sstream>
@@ -148,3 +151,100 @@ static std::list<const char*> getFileNames() {
  * Create the new tests.
  */
 INSTANTIATE_TEST_CASE_P(,FromBCToToWhy3WithoutErrorsTests,::testing::ValuesIn(getFileNames()));
+
+/**
+ * The test class for lazy loading. Used to specify the format of the parameter.
+ */
+class LazyLoadTests : public ::testing::TestWithParam<const char*> {};
+
+/**
+ * Finds the functions of a module lazy loading should keep the bodies of: those with annotations, and every function they refer to, directly or not.
+ */
+static std::unordered_set<llvm::Function*> getSlice(llvm::Module* mod) {
+    using namespace std;
+    using namespace llvm;
+    using namespace whyr;
+    
+    list<Function*> worklist;
+    for (Module::iterator ii = mod->begin(); ii != mod->end(); ii++) {
+        bool annotated = ii->getMetadata("whyr.requires") || ii->getMetadata("whyr.ensures") || ii->getMetadata("whyr.assigns");
+        for (inst_iterator jj = inst_begin(&*ii); jj != inst_end(&*ii); jj++) {
+            annotated = annotated || AnnotatedInstruction::isAnnotated(&*jj);
+        }
+        if (annotated) {
+            worklist.push_back(&*ii);
+        }
+    }
+    
+    unordered_set<Function*> slice(worklist.begin(), worklist.end());
+    while (!worklist.empty()) {
+        Function* func = worklist.front();
+        worklist.pop_front();
+        for (inst_iterator ii = inst_begin(func); ii != inst_end(func); ii++) {
+            for (User::op_iterator jj = ii->op_begin(); jj != ii->op_end(); jj++) {
+                Function* callee = dyn_cast<Function>((*jj)->stripPointerCasts());
+                if (callee && slice.insert(callee).second) {
+                    worklist.push_back(callee);
+                }
+            }
+        }
+    }
+    return slice;
+}
+
+/**
+ * The test function. Runs once for every bitcode file.
+ * Loads the file both eagerly and lazily, and checks that the lazy module keeps the body of every function in the slice, and no other body.
+ * The file is loaded lazily both as bitcode and through the IR loader, which is what the default '-f auto' uses, and must pass bitcode on.
+ */
+TEST_P(LazyLoadTests,) {
+    using namespace std;
+    using namespace llvm;
+    using namespace whyr;
+    
+    string fileLoc = string("test/data/bc_files/") + GetParam();
+    WhyRSettings* lazySettings = new WhyRSettings();
+    lazySettings->lazyLoad = true;
+    WhyRSettings* autoSettings = new WhyRSettings();
+    autoSettings->lazyLoad = true;
+    AnnotatedModule* eager = AnnotatedModule::moduleFromBitcodeFile(fileLoc.c_str(), new WhyRSettings());
+    AnnotatedModule* lazy = AnnotatedModule::moduleFromBitcodeFile(fileLoc.c_str(), lazySettings);
+    AnnotatedModule* lazyAuto = AnnotatedModule::moduleFromIRFile(fileLoc.c_str(), autoSettings);
+    ASSERT_TRUE(eager);
+    ASSERT_TRUE(lazy);
+    ASSERT_TRUE(lazyAuto);
+    unordered_set<Function*> slice = getSlice(eager->rawIR());
+    eager->annotate();
+    
+    AnnotatedModule* lazyModules[] = {lazy, lazyAuto};
+    for (unsigned i = 0; i < sizeof(lazyModules) / sizeof(lazyModules[0]); i++) {
+        SCOPED_TRACE(i == 0 ? "moduleFromBitcodeFile" : "moduleFromIRFile");
+        lazyModules[i]->annotate();
+        
+        for (list<AnnotatedFunction*>::iterator ii = eager->getFunctions()->begin(); ii != eager->getFunctions()->end(); ii++) {
+            Function* lazyFunc = lazyModules[i]->rawIR()->getFunction((*ii)->rawIR()->getName());
+            ASSERT_TRUE(lazyFunc);
+            if ((*ii)->getRequiresClause() || (*ii)->getEnsuresClause() || !(*ii)->getAnnotatedInstructions()->empty()) {
+                EXPECT_FALSE(lazyFunc->isDeclaration());
+            }
+            if ((*ii)->rawIR()->isDeclaration()) {
+                EXPECT_TRUE(lazyFunc->isDeclaration());
+            } else {
+                // an unannotated function nothing in the slice refers to is only a declaration
+                EXPECT_EQ(slice.count((*ii)->rawIR()) == 0, lazyFunc->isDeclaration());
+            }
+        }
+        
+        ostringstream out;
+        ASSERT_NO_THROW(generateWhy3(out, lazyModules[i]));
+    }
+    
+    delete eager;
+    delete lazy;
+    delete lazyAuto;
+}
+
+/**
+ * Create the new tests.
+ */
+INSTANTIATE_TEST_CASE_P(,LazyLoadTests,::testing::ValuesIn(getFileNames()));
@@ -0,0 +1,180 @@
+/*
+ * test_function_filter.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "test_common.hpp"
+
+#include <whyr/module.hpp>
+#include <whyr/esc_why3.hpp>
+#include <whyr/exception.hpp>
+
+#include <string>
+#include <sstream>
+
+static const char* FILTER_IR =
+    "define i32 @f(i32 %x) !whyr.requires !{!{!\"eq\", !{!\"arg\", !\"x\"}, i32 4}} {\n"
+    "    %a = add i32 2, 2\n"
+    "    ret i32 %a\n"
+    "}\n"
+    "\n"
+    "define i32 @g(i32 %x) !whyr.ensures !{!{!\"eq\", !{!\"result\"}, !{!\"arg\", !\"x\"}}} {\n"
+    "    ret i32 %x\n"
+    "}\n"
+    "\n"
+    "define i32 @main() !whyr.ensures !{!{!\"eq\", !{!\"result\"}, i32 4}} {\n"
+    "    %b = call i32 @f(i32 4)\n"
+    "    ret i32 %b\n"
+    "}\n";
+
+/**
+ * Selects only main, and checks its callee f is kept as a contract only, and g, which nothing selected calls, is left out.
+ */
+TEST(FunctionFilterTests, SelectsCallers) {
+    using namespace std;
+    using namespace whyr;
+    
+    istringstream in(FILTER_IR);
+    WhyRSettings settings;
+    settings.functionFilters.push_back("ma.*");
+    AnnotatedModule* module = AnnotatedModule::moduleFromIR(in, "<test>", &settings);
+    ASSERT_TRUE(module);
+    module->annotate();
+    
+    EXPECT_EQ(2u, module->getFunctions()->size());
+    ASSERT_TRUE(module->getFunction("main"));
+    ASSERT_TRUE(module->getFunction("f"));
+    EXPECT_FALSE(module->getFunction("g"));
+    EXPECT_FALSE(module->getFunction("main")->rawIR()->isDeclaration());
+    EXPECT_TRUE(module->getFunction("f")->rawIR()->isDeclaration());
+    // the contract of f is still there, so main still has to meet it
+    EXPECT_TRUE(module->getFunction("f")->getRequiresClause());
+    
+    ostringstream out;
+    generateWhy3(out, module);
+    string why3 = out.str();
+    EXPECT_EQ(string::npos, why3.find("theory Function_g"));
+    EXPECT_NE(string::npos, why3.find("theory Function_f"));
+    EXPECT_NE(string::npos, why3.find("goal Goal_main"));
+    EXPECT_EQ(string::npos, why3.find("goal Goal_f"));
+    
+    delete module;
+}
+
+/**
+ * Checks that a filter must match the whole name, and an invalid one is reported.
+ */
+TEST(FunctionFilterTests, MatchesWholeName) {
+    using namespace std;
+    using namespace whyr;
+    
+    {
+        istringstream in(FILTER_IR);
+        WhyRSettings settings;
+        settings.functionFilters.push_back("ma");
+        AnnotatedModule* module = AnnotatedModule::moduleFromIR(in, "<test>", &settings);
+        ASSERT_TRUE(module);
+        module->annotate();
+        EXPECT_TRUE(module->getFunctions()->empty());
+        delete module;
+    }
+    
+    {
+        istringstream in(FILTER_IR);
+        WhyRSettings settings;
+        settings.functionFilters.push_back("(");
+        AnnotatedModule* module = AnnotatedModule::moduleFromIR(in, "<test>", &settings);
+        ASSERT_TRUE(module);
+        EXPECT_THROW(module->annotate(), whyr_exception);
+        delete module;
+    }
+}
+
+static const char* BADDR_IR =
+    "define i8* @get_baddr() !whyr.ensures !{!{!\"eq\", !{!\"result\"}, i8* blockaddress(@rando, %RandoLabel)}} {\n"
+    "    ret i8* blockaddress(@rando, %RandoLabel)\n"
+    "}\n"
+    "\n"
+    "define void @rando() {\n"
+    "    %a = call i32 @h(i32 4)\n"
+    "    unreachable\n"
+    "RandoLabel:\n"
+    "    unreachable\n"
+    "}\n"
+    "\n"
+    "define i32 @h(i32 %x) !whyr.requires !{!{!\"eq\", !{!\"arg\", !\"x\"}, i32 4}} {\n"
+    "    ret i32 %x\n"
+    "}\n"
+    "\n"
+    "define i8* @by_constant() !whyr.ensures !{!{!\"eq\", !{!\"result\"}, i8* blockaddress(@other, %OtherLabel)}} {\n"
+    "    ret i8* null\n"
+    "}\n"
+    "\n"
+    "define i8* @by_name() !whyr.ensures !{!{!\"eq\", !{!\"result\"}, !{!\"blockaddress\", !\"other\", !\"OtherLabel\"}}} {\n"
+    "    ret i8* null\n"
+    "}\n"
+    "\n"
+    "define void @other() {\n"
+    "    unreachable\n"
+    "OtherLabel:\n"
+    "    unreachable\n"
+    "}\n";
+
+/**
+ * Selects a function that addresses the blocks of another, and checks the other keeps its body, and what it calls, but has no goals of its own.
+ */
+TEST(FunctionFilterTests, KeepsAddressed) {
+    using namespace std;
+    using namespace whyr;
+    
+    istringstream in(BADDR_IR);
+    WhyRSettings settings;
+    settings.functionFilters.push_back("get_baddr");
+    AnnotatedModule* module = AnnotatedModule::moduleFromIR(in, "<test>", &settings);
+    ASSERT_TRUE(module);
+    module->annotate();
+    
+    ASSERT_TRUE(module->getFunction("rando"));
+    ASSERT_TRUE(module->getFunction("h"));
+    EXPECT_FALSE(module->getFunction("rando")->rawIR()->isDeclaration());
+    EXPECT_TRUE(module->getFunction("h")->rawIR()->isDeclaration());
+    EXPECT_TRUE(module->isSelected(module->getFunction("get_baddr")->rawIR()));
+    EXPECT_FALSE(module->isSelected(module->getFunction("rando")->rawIR()));
+    
+    ostringstream out;
+    generateWhy3(out, module);
+    string why3 = out.str();
+    EXPECT_NE(string::npos, why3.find("goal Goal_get_baddr"));
+    EXPECT_EQ(string::npos, why3.find("goal Goal_rando"));
+    
+    delete module;
+}
+
+/**
+ * Selects functions that address the blocks of another only from their annotations, by constant and by name, and checks it keeps its body.
+ */
+TEST(FunctionFilterTests, KeepsAddressedByAnnotations) {
+    using namespace std;
+    using namespace whyr;
+    
+    const char* filters[] = {"by_constant", "by_name"};
+    for (unsigned i = 0; i < sizeof(filters) / sizeof(filters[0]); i++) {
+        SCOPED_TRACE(filters[i]);
+        istringstream in(BADDR_IR);
+        WhyRSettings settings;
+        settings.functionFilters.push_back(filters[i]);
+        AnnotatedModule* module = AnnotatedModule::moduleFromIR(in, "<test>", &settings);
+        ASSERT_TRUE(module);
+        module->annotate();
+        
+        ASSERT_TRUE(module->getFunction("other"));
+        EXPECT_FALSE(module->getFunction("other")->rawIR()->isDeclaration());
+        EXPECT_FALSE(module->getFunction("rando"));
+        
+        ostringstream out;
+        EXPECT_NO_THROW(generateWhy3(out, module));
+        
+        delete module;
+    }
+}
@@ -0,0 +1,114 @@
+/*
+ * test_import.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "test_common.hpp"
+
+#include <whyr/module.hpp>
+#include <whyr/esc_why3.hpp>
+#include <whyr/exception.hpp>
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <streambuf>
+
+static const char* IR_FILE = "test/data/ir_files/add_2_2_with_call.ll";
+static const char* BC_FILE = "test/data/bc_files/add_2_2_with_call.bc";
+
+/**
+ * A stream buffer over a string that cannot seek or tell its position, as with a pipe.
+ */
+class UnseekableStreamBuf : public std::streambuf {
+    std::string contents;
+public:
+    UnseekableStreamBuf(const std::string &contents) : contents{contents} {
+        char* start = &this->contents[0];
+        setg(start, start, start + this->contents.size());
+    }
+};
+
+/**
+ * Annotates a module and returns its Why3, or an empty string if the module could not be loaded.
+ */
+static std::string getWhy3(whyr::AnnotatedModule* module) {
+    using namespace std;
+    using namespace whyr;
+    
+    if (!module) {
+        return "";
+    }
+    module->annotate();
+    ostringstream out;
+    generateWhy3(out, module);
+    delete module;
+    return out.str();
+}
+
+/**
+ * Returns the whole contents of a file.
+ */
+static std::string readFile(const char* fileName) {
+    using namespace std;
+    
+    ifstream file(fileName, ios::binary);
+    ostringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+/**
+ * Checks the file loaders load the same modules as the stream loaders given a file, which can be read straight into a buffer.
+ */
+TEST(ImportTests, FileLoaders) {
+    using namespace std;
+    using namespace whyr;
+    
+    ifstream irFile(IR_FILE);
+    string irStream = getWhy3(AnnotatedModule::moduleFromIR(irFile, IR_FILE, new WhyRSettings()));
+    EXPECT_FALSE(irStream.empty());
+    EXPECT_EQ(irStream, getWhy3(AnnotatedModule::moduleFromIRFile(IR_FILE, new WhyRSettings())));
+    
+    ifstream bcFile(BC_FILE, ios::binary);
+    string bcStream = getWhy3(AnnotatedModule::moduleFromBitcode(bcFile, BC_FILE, new WhyRSettings()));
+    EXPECT_FALSE(bcStream.empty());
+    EXPECT_EQ(bcStream, getWhy3(AnnotatedModule::moduleFromBitcodeFile(BC_FILE, new WhyRSettings())));
+}
+
+/**
+ * Checks the file loaders return NULL for a file that does not exist.
+ */
+TEST(ImportTests, MissingFile) {
+    using namespace whyr;
+    
+    EXPECT_FALSE(AnnotatedModule::moduleFromIRFile("test/data/ir_files/does_not_exist.ll", new WhyRSettings()));
+    EXPECT_FALSE(AnnotatedModule::moduleFromBitcodeFile("test/data/bc_files/does_not_exist.bc", new WhyRSettings()));
+}
+
+/**
+ * Checks the stream loaders read a stream that cannot tell its size in chunks, and load the same modules as from a file.
+ * The IR is padded with comments so it takes several chunks.
+ */
+TEST(ImportTests, ChunkedStream) {
+    using namespace std;
+    using namespace whyr;
+    
+    string ir = readFile(IR_FILE);
+    while (ir.size() < 3 * 65536 + 100) {
+        ir += "; padding to make the stream take more than one chunk to read\n";
+    }
+    UnseekableStreamBuf irBuf(ir);
+    istream irStream(&irBuf);
+    ASSERT_EQ(istream::pos_type(-1), irStream.tellg());
+    string irChunked = getWhy3(AnnotatedModule::moduleFromIR(irStream, IR_FILE, new WhyRSettings()));
+    EXPECT_FALSE(irChunked.empty());
+    EXPECT_EQ(getWhy3(AnnotatedModule::moduleFromIRFile(IR_FILE, new WhyRSettings())), irChunked);
+    
+    UnseekableStreamBuf bcBuf(readFile(BC_FILE));
+    istream bcStream(&bcBuf);
+    string bcChunked = getWhy3(AnnotatedModule::moduleFromBitcode(bcStream, BC_FILE, new WhyRSettings()));
+    EXPECT_FALSE(bcChunked.empty());
+    EXPECT_EQ(getWhy3(AnnotatedModule::moduleFromBitcodeFile(BC_FILE, new WhyRSettings())), bcChunked);
+}
@@ -0,0 +1,93 @@
+/*
+ * test_jobs.cpp
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "test_common.hpp"
+
+#include <whyr/module.hpp>
+#include <whyr/esc_why3.hpp>
+#include <whyr/exception.hpp>
+#include <whyr/rte.hpp>
+
+#include <list>
+#include <string>
+#include <sstream>
+
+#include <dirent.h>
+#include <string.h>
+
+/**
+ * Generates the Why3 of an IR file on some number of threads, with or without shared goals.
+ */
+static std::string getWhy3(const char* fileName, unsigned jobs, bool sharedGoals) {
+    using namespace std;
+    using namespace whyr;
+    
+    WhyRSettings settings;
+    settings.jobs = jobs;
+    settings.sharedGoals = sharedGoals;
+    AnnotatedModule* module = AnnotatedModule::moduleFromIRFile(fileName, &settings);
+    if (!module) {
+        return "";
+    }
+    module->annotate();
+    addRTE(module);
+    
+    ostringstream out;
+    generateWhy3(out, module);
+    delete module;
+    return out.str();
+}
+
+/**
+ * The test class. Used to specify the format of the parameter.
+ */
+class JobsTests : public ::testing::TestWithParam<const char*> {};
+
+/**
+ * The test function. Runs once for every IR file, and checks the goals come out the same no matter how many threads generate them.
+ */
+TEST_P(JobsTests,) {
+    using namespace std;
+    using namespace whyr;
+    
+    try {
+        string serial = getWhy3(GetParam(), 1, false);
+        ASSERT_FALSE(serial.empty());
+        EXPECT_EQ(serial, getWhy3(GetParam(), 4, false));
+        
+        string sharedSerial = getWhy3(GetParam(), 1, true);
+        ASSERT_FALSE(sharedSerial.empty());
+        EXPECT_EQ(sharedSerial, getWhy3(GetParam(), 4, true));
+    } catch (whyr_exception ex) {
+        string errMsg = string("'") + ex.what() + "'";
+        FAIL_WITH_MESSAGE(errMsg);
+    }
+}
+
+/**
+ * Finds the names of all the IR files, except the failure tests.
+ */
+static std::list<const char*> getFileNames() {
+    std::list<const char*> a;
+    
+    DIR* dir = opendir("test/data/ir_files");
+    dirent* d = readdir(dir);
+    while (d) {
+        if (d->d_name[0] != '.' && strncmp(d->d_name, "fail", 4) != 0) { // ignore . and .., hidden files such as .svn, and failure tests
+            a.push_back(strdup((std::string("test/data/ir_files/")+d->d_name).c_str()));
+        }
+        
+        d = readdir(dir);
+    }
+    closedir(dir);
+    
+    return a;
+}
+
+/**
+ * Create the new tests.
+ */
+INSTANTIATE_TEST_CASE_P(,JobsTests,::testing::ValuesIn(getFileNames()));
@@ -0,0 +1,156 @@
+/*
+ * test_manifest.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "test_common.hpp"
+
+#include <whyr/module.hpp>
+#include <whyr/esc_why3.hpp>
+#include <whyr/exec_why3.hpp>
+#include <whyr/manifest.hpp>
+#include <whyr/exception.hpp>
+
+#include <string>
+#include <sstream>
+
+#include <stdio.h>
+#include <unistd.h>
+
+static const char* CALLER_IR =
+    "define i32 @f(i32 %x) !whyr.requires !{!{!\"eq\", !{!\"arg\", !\"x\"}, i32 4}} {\n"
+    "    %a = add i32 2, 2\n"
+    "    ret i32 %a\n"
+    "}\n"
+    "\n"
+    "define i32 @main() !whyr.ensures !{!{!\"eq\", !{!\"result\"}, i32 4}} {\n"
+    "    %b = call i32 @f(i32 4)\n"
+    "    ret i32 %b\n"
+    "}\n";
+
+/**
+ * Generates the goals of some IR with a manifest, and returns the number of goals generated.
+ * Every goal generated is recorded as valid in the manifest, as if Why3 had proven it.
+ * If filter is given, only the functions it matches are verified.
+ */
+static unsigned generateWithManifest(const std::string &ir, whyr::Why3Manifest &manifest, const char* filter = NULL) {
+    using namespace std;
+    using namespace whyr;
+    
+    istringstream in(ir);
+    WhyRSettings settings;
+    settings.manifest = &manifest;
+    if (filter) {
+        settings.functionFilters.push_back(filter);
+    }
+    AnnotatedModule* module = AnnotatedModule::moduleFromIR(in, "<test>", &settings);
+    if (!module) {
+        return 0;
+    }
+    module->annotate();
+    
+    ostringstream out;
+    generateWhy3(out, module);
+    delete module;
+    
+    // pretend Why3 proved every goal
+    unsigned goals = 0;
+    ostringstream results;
+    istringstream lines(out.str());
+    string line, theory;
+    while (getline(lines, line)) {
+        if (line.compare(0, 7, "theory ") == 0) {
+            theory = line.substr(7);
+        } else if (line.compare(0, 9, "    goal ") == 0) {
+            results << "test.why " << theory << " " << line.substr(9, line.find(':') - 9) << " : Valid (0.01s)" << endl;
+            goals++;
+        }
+    }
+    Why3Output proven(results.str().c_str());
+    manifest.addResults(proven);
+    return goals;
+}
+
+/**
+ * Proves a module twice, and checks the second run generates no goals, and reuses the results of the first.
+ * Then changes a callee, and checks the goals of its caller come back.
+ */
+TEST(ManifestTests, ReuseUnchanged) {
+    using namespace std;
+    using namespace whyr;
+    
+    string path = "/tmp/whyr_test_manifest_" + to_string(getpid());
+    remove(path.c_str());
+    
+    {
+        Why3Manifest manifest(path, "test");
+        EXPECT_EQ(2u, generateWithManifest(CALLER_IR, manifest));
+        manifest.save();
+    }
+    
+    {
+        Why3Manifest manifest(path, "test");
+        EXPECT_EQ(0u, generateWithManifest(CALLER_IR, manifest));
+        
+        Why3Output reused;
+        manifest.getReusedResults(reused);
+        ASSERT_EQ(2u, reused.goals.size());
+        for (list<Why3Goal>::iterator ii = reused.goals.begin(); ii != reused.goals.end(); ii++) {
+            EXPECT_EQ(Why3Goal::STATUS_VALID, ii->status);
+            EXPECT_TRUE(ii->cached);
+        }
+        manifest.save();
+    }
+    
+    {
+        // main calls f, so changing f changes the goals of main
+        string changed(CALLER_IR);
+        changed.replace(changed.find("add i32 2, 2"), 12, "add i32 1, 3");
+        Why3Manifest manifest(path, "test");
+        EXPECT_EQ(2u, generateWithManifest(changed, manifest));
+    }
+    
+    {
+        // a different context throws away everything
+        Why3Manifest manifest(path, "other");
+        EXPECT_EQ(2u, generateWithManifest(CALLER_IR, manifest));
+    }
+    
+    remove(path.c_str());
+}
+
+/**
+ * Proves only some of the functions of a module, and checks the results saved for the others are kept.
+ */
+TEST(ManifestTests, KeepFilteredOut) {
+    using namespace std;
+    using namespace whyr;
+    
+    string path = "/tmp/whyr_test_manifest_" + to_string(getpid());
+    remove(path.c_str());
+    
+    {
+        Why3Manifest manifest(path, "test");
+        EXPECT_EQ(2u, generateWithManifest(CALLER_IR, manifest));
+        manifest.save();
+    }
+    
+    {
+        // main is left out, so its results are neither reused nor proven again
+        Why3Manifest manifest(path, "test");
+        EXPECT_EQ(0u, generateWithManifest(CALLER_IR, manifest, "f"));
+        manifest.save();
+    }
+    
+    {
+        Why3Manifest manifest(path, "test");
+        EXPECT_EQ(0u, generateWithManifest(CALLER_IR, manifest));
+        
+        Why3Output reused;
+        manifest.getReusedResults(reused);
+        EXPECT_EQ(2u, reused.goals.size());
+    }
+    
+    remove(path.c_str());
+}
@@ -0,0 +1,132 @@
+/*
+ * test_output.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "test_common.hpp"
+
+#include <whyr/output.hpp>
+
+#include <string>
+#include <sstream>
+
+#include <unistd.h>
+#include <string.h>
+#include <sys/wait.h>
+
+/**
+ * Writes more than a buffer's worth through a FdStreamBuf into a pipe, and checks it all comes out the other end.
+ */
+TEST(OutputTests, FdStreamBufPipe) {
+    using namespace std;
+    using namespace whyr;
+    
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    
+    string expected;
+    {
+        FdOstream out(fds[1], true, 16);
+        for (int i = 0; i < 100; i++) {
+            out << "line " << i << endl;
+            expected += "line " + to_string(i) + "\n";
+        }
+        ASSERT_TRUE(out.good());
+    }
+    
+    string actual;
+    char buf[128];
+    ssize_t n;
+    while ((n = read(fds[0], buf, sizeof(buf))) > 0) {
+        actual.append(buf, n);
+    }
+    close(fds[0]);
+    
+    ASSERT_EQ(expected, actual);
+}
+
+/**
+ * Checks that a TeeStreamBuf sends the same output to both of its stream buffers.
+ */
+TEST(OutputTests, TeeStreamBuf) {
+    using namespace std;
+    using namespace whyr;
+    
+    ostringstream first, second;
+    TeeStreamBuf tee(first.rdbuf(), second.rdbuf());
+    ostream out(&tee);
+    out << "theory A" << endl << 'x' << 42 << endl;
+    out.flush();
+    
+    ASSERT_TRUE(out.good());
+    ASSERT_EQ("theory A\nx42\n", first.str());
+    ASSERT_EQ(first.str(), second.str());
+}
+
+/**
+ * Writes much more than a pipe can hold through a DuplexStreamBuf into 'cat', and checks it all comes back.
+ * Writing everything before reading anything would deadlock here.
+ */
+TEST(OutputTests, DuplexStreamBufCat) {
+    using namespace std;
+    using namespace whyr;
+    
+    int inpipe[2];
+    int outpipe[2];
+    ASSERT_EQ(0, pipe(inpipe));
+    ASSERT_EQ(0, pipe(outpipe));
+    
+    pid_t pid = fork();
+    ASSERT_NE(-1, pid);
+    if (pid == 0) {
+        dup2(inpipe[0], 0);
+        dup2(outpipe[1], 1);
+        close(inpipe[0]); close(inpipe[1]);
+        close(outpipe[0]); close(outpipe[1]);
+        execlp("cat", "cat", NULL);
+        _exit(1);
+    }
+    close(inpipe[0]);
+    close(outpipe[1]);
+    
+    string expected;
+    ostringstream actual;
+    {
+        DuplexStreamBuf buf(inpipe[1], outpipe[0], actual.rdbuf());
+        ostream out(&buf);
+        for (int i = 0; i < 100000; i++) {
+            out << "line " << i << endl;
+            expected += "line " + to_string(i) + "\n";
+        }
+        ASSERT_TRUE(out.good());
+        buf.close();
+        ASSERT_TRUE(buf.readAll());
+    }
+    waitpid(pid, NULL, 0);
+    
+    ASSERT_EQ(expected, actual.str());
+}
+
+/**
+ * Writes two theories through a TheorySizeStreamBuf a piece at a time, and checks each is measured from its header to its "end".
+ */
+TEST(OutputTests, TheorySizes) {
+    using namespace std;
+    using namespace whyr;
+    
+    string first = "theory A\n    type t\nend\n";
+    string second = "theory Goal_b\n    goal Goal_b: true\nend\n";
+    string code = "(* header *)\n" + first + "\n" + second;
+    
+    TheorySizeStreamBuf sizes;
+    ostream out(&sizes);
+    for (size_t i = 0; i < code.size(); i += 3) {
+        out << code.substr(i, 3);
+    }
+    out.put('\n');
+    
+    EXPECT_EQ(first.size(), sizes.getSize("A"));
+    EXPECT_EQ(second.size(), sizes.getSize("Goal_b"));
+    EXPECT_EQ(0u, sizes.getSize("C"));
+}
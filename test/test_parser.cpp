@@ -0,0 +1,47 @@
+/*
+ * test_parser.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "test_common.hpp"
+
+#include <whyr/module.hpp>
+#include <whyr/expressions.hpp>
+#include <whyr/exception.hpp>
+
+#include <string>
+#include <sstream>
+
+static const char* SHARED_TYPE_IR =
+    "define i32 @f(i32 %x) !whyr.requires !{!{!\"forall\", !{!{!\"i\", !{!\"typeof\", !{!\"arg\", !\"x\"}}}}, !{!\"eq\", !{!\"local\", !\"i\"}, !{!\"local\", !\"i\"}}}} !whyr.ensures !{!{!\"forall\", !{!{!\"i\", !{!\"typeof\", !{!\"arg\", !\"x\"}}}}, !{!\"eq\", !{!\"local\", !\"i\"}, !{!\"local\", !\"i\"}}}} {\n"
+    "    ret i32 %x\n"
+    "}\n";
+
+/**
+ * Uses the same type node in the requires and ensures clauses, and checks it is only parsed once.
+ */
+TEST(ParserTests, SharesTypeNodes) {
+    using namespace std;
+    using namespace whyr;
+    
+    istringstream in(SHARED_TYPE_IR);
+    WhyRSettings settings;
+    AnnotatedModule* module = AnnotatedModule::moduleFromIR(in, "<test>", &settings);
+    ASSERT_TRUE(module);
+    module->annotate();
+    
+    AnnotatedFunction* func = module->getFunction("f");
+    ASSERT_TRUE(func);
+    ASSERT_TRUE(isa<LogicExpressionQuantifier>(func->getRequiresClause()));
+    ASSERT_TRUE(isa<LogicExpressionQuantifier>(func->getEnsuresClause()));
+    LogicLocal* requiresLocal = cast<LogicExpressionQuantifier>(func->getRequiresClause())->getLocals()->front();
+    LogicLocal* ensuresLocal = cast<LogicExpressionQuantifier>(func->getEnsuresClause())->getLocals()->front();
+    
+    // the typeof node and the arg node inside it
+    EXPECT_EQ(2u, module->getParsedTypes()->size());
+    EXPECT_EQ(requiresLocal->type, ensuresLocal->type);
+    EXPECT_EQ("i32", requiresLocal->type->toString());
+    
+    delete module;
+}
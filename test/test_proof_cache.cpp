@@ -0,0 +1,81 @@
+/*
+ * test_proof_cache.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "test_common.hpp"
+
+#include <whyr/proof_cache.hpp>
+
+#include <string>
+
+#include <stdlib.h>
+
+/**
+ * Stores a result, and checks it is read back the same under the same key, and not found under a different one.
+ */
+TEST(ProofCacheTests, StoreAndLookup) {
+    using namespace std;
+    using namespace whyr;
+    
+    char dir[] = "/tmp/whyr_cache_XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir));
+    
+    Why3Limits limits;
+    limits.time = 5;
+    Why3ProofCache cache(dir, PROVER_ALT_ERGO, limits);
+    
+    string key = cache.getKey("theory Goal_a\n    goal Goal_a: true\nend\n");
+    ASSERT_EQ(key, cache.getKey("theory Goal_a\n    goal Goal_a: true\nend\n"));
+    ASSERT_NE(key, cache.getKey("theory Goal_a\n    goal Goal_a: false\nend\n"));
+    
+    string found;
+    ASSERT_FALSE(cache.lookup(key, found));
+    
+    Why3Output result("file.why Goal_a Goal_a : Valid (0.25s, 12 steps)\n");
+    cache.store(key, result);
+    ASSERT_TRUE(cache.lookup(key, found));
+    
+    Why3Output cached(found.c_str());
+    ASSERT_FALSE(cached.error);
+    ASSERT_EQ(1u, cached.goals.size());
+    EXPECT_STREQ("Goal_a", cached.goals.front().theory);
+    EXPECT_STREQ("Goal_a", cached.goals.front().goal);
+    EXPECT_EQ(Why3Goal::STATUS_VALID, cached.goals.front().status);
+    EXPECT_DOUBLE_EQ(0.25, cached.goals.front().time);
+    EXPECT_EQ(12, cached.goals.front().steps);
+    
+    // a cache with different limits must not see the result
+    limits.time = 10;
+    Why3ProofCache other(dir, PROVER_ALT_ERGO, limits);
+    ASSERT_NE(key, other.getKey("theory Goal_a\n    goal Goal_a: true\nend\n"));
+    
+    system((string("rm -rf ") + dir).c_str());
+}
+
+/**
+ * Remembers the winners of goals with the same name in different modules and theories, and checks they are kept apart.
+ */
+TEST(ProofCacheTests, Winners) {
+    using namespace std;
+    using namespace whyr;
+    
+    char dir[] = "/tmp/whyr_cache_XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir));
+    
+    Why3ProofCache cache(dir, PROVER_ALT_ERGO, Why3Limits());
+    EXPECT_EQ("", cache.getWinner("a.ll", "Goal_f", "Goal_f_assert_1"));
+    
+    cache.setWinner("a.ll", "Goal_f", "Goal_f_assert_1", PROVER_Z3);
+    cache.setWinner("b.ll", "Goal_f", "Goal_f_assert_1", PROVER_CVC4);
+    EXPECT_EQ(PROVER_Z3, cache.getWinner("a.ll", "Goal_f", "Goal_f_assert_1"));
+    EXPECT_EQ(PROVER_CVC4, cache.getWinner("b.ll", "Goal_f", "Goal_f_assert_1"));
+    EXPECT_EQ("", cache.getWinner("a.ll", "Goal_g", "Goal_f_assert_1"));
+    
+    // a later win replaces an earlier one
+    cache.setWinner("a.ll", "Goal_f", "Goal_f_assert_1", PROVER_ALT_ERGO);
+    EXPECT_EQ(PROVER_ALT_ERGO, cache.getWinner("a.ll", "Goal_f", "Goal_f_assert_1"));
+    
+    system((string("rm -rf ") + dir).c_str());
+}
@@ -0,0 +1,68 @@
+/*
+ * test_shared_goals.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#include "test_common.hpp"
+
+#include <whyr/module.hpp>
+#include <whyr/esc_why3.hpp>
+#include <whyr/exception.hpp>
+#include <whyr/rte.hpp>
+
+#include <list>
+#include <string>
+#include <sstream>
+
+/**
+ * Generates the Why3 of an IR file, and returns the names of its goals in the order they were generated.
+ */
+static std::list<std::string> getGoalNames(const char* fileName, bool sharedGoals) {
+    using namespace std;
+    using namespace whyr;
+
+    list<string> names;
+    WhyRSettings settings;
+    settings.sharedGoals = sharedGoals;
+    AnnotatedModule* module = AnnotatedModule::moduleFromIRFile(fileName, &settings);
+    if (!module) {
+        return names;
+    }
+    module->annotate();
+    addRTE(module);
+    
+    ostringstream out;
+    generateWhy3(out, module);
+    delete module;
+    
+    istringstream lines(out.str());
+    string line;
+    while (getline(lines, line)) {
+        if (line.compare(0, 9, "    goal ") == 0) {
+            names.push_back(line.substr(9, line.find(':') - 9));
+        }
+    }
+    return names;
+}
+
+/**
+ * Checks that shared goal mode generates exactly the goals the per-goal mode does, under the same names.
+ */
+TEST(SharedGoalsTests, SameGoalsAsPerGoal) {
+    using namespace std;
+    
+    const char* files[] = {
+        "test/data/ir_files/add_2_2_with_call.ll",
+        "test/data/ir_files/assert_assume.ll",
+        "test/data/ir_files/diamond_branch.ll",
+        "test/data/ir_files/assigns_call.ll",
+    };
+    for (unsigned i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        SCOPED_TRACE(files[i]);
+        list<string> perGoal = getGoalNames(files[i], false);
+        list<string> shared = getGoalNames(files[i], true);
+        EXPECT_FALSE(perGoal.empty());
+        EXPECT_EQ(perGoal, shared);
+    }
+}
@@ -13,6 +13,10 @@
 #include <whyr/types.hpp>
 #include <whyr/war.hpp>
 
+#include <string>
+#include <sstream>
+#include <thread>
+
 struct WarTestData {
     std::string input;
     whyr::LogicType* type;
@@ -188,3 +192,69 @@ INSTANTIATE_TEST_CASE_P(,WarTests,(setup(), ::testing::ValuesIn((WarTestData[]){
     {"(i32*)null offset 0", new whyr::LogicTypeLLVM(llvm::PointerType::get(llvm::Type::getIntNTy(*ctx,32), 0))},
     {"(set) {(i32*)null} offset (1..4)", new whyr::LogicTypeSet(new whyr::LogicTypeLLVM(llvm::PointerType::get(llvm::Type::getIntNTy(*ctx,32), 0)))},
 })));
+
+static const char* WAR_THREAD_IR[] = {
+    "define i1 @f() !whyr.ensures !{!{!\"war\", !\"true ==> false || true <==> (true && false) ==> false\"}} {\n"
+    "    ret i1 true\n"
+    "}\n",
+    "define i1 @g() !whyr.ensures !{!{!\"war\", !\"exists int $a; exists int $b; $a == $b\"}} {\n"
+    "    ret i1 true\n"
+    "}\n",
+};
+
+/**
+ * Loads and annotates a module with a WAR annotation, and returns its ensures clause as text, or the error annotating it gave.
+ */
+static std::string annotateWar(const char* ir) {
+    using namespace std; using namespace llvm; using namespace whyr;
+    
+    istringstream in(ir);
+    WhyRSettings settings;
+    AnnotatedModule* module = AnnotatedModule::moduleFromIR(in, "<test case>", &settings);
+    if (!module) {
+        return "error: could not load module";
+    }
+    
+    string result;
+    try {
+        module->annotate();
+        result = module->getFunctions()->front()->getEnsuresClause()->toString();
+    } catch (whyr_exception ex) {
+        result = string("error: ") + ex.what();
+    }
+    delete module;
+    return result;
+}
+
+/**
+ * Annotates two modules with WAR annotations over and over, each on its own thread, and checks every parse gives what it does alone.
+ */
+TEST(WarThreadTests, TwoThreads) {
+    using namespace std;
+    
+    const unsigned inputs = sizeof(WAR_THREAD_IR) / sizeof(WAR_THREAD_IR[0]);
+    string expected[inputs];
+    for (unsigned i = 0; i < inputs; i++) {
+        expected[i] = annotateWar(WAR_THREAD_IR[i]);
+        ASSERT_NE(0u, expected[i].compare(0, 6, "error:")) << expected[i];
+    }
+    
+    unsigned mismatches[inputs] = {};
+    vector<thread> threads;
+    for (unsigned i = 0; i < inputs; i++) {
+        threads.push_back(thread([&, i]() {
+            for (unsigned j = 0; j < 200; j++) {
+                if (annotateWar(WAR_THREAD_IR[i]) != expected[i]) {
+                    mismatches[i]++;
+                }
+            }
+        }));
+    }
+    for (vector<thread>::iterator ii = threads.begin(); ii != threads.end(); ii++) {
+        ii->join();
+    }
+    
+    for (unsigned i = 0; i < inputs; i++) {
+        EXPECT_EQ(0u, mismatches[i]) << WAR_THREAD_IR[i];
+    }
+}